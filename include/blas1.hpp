@@ -16,8 +16,64 @@
 #ifndef BLAS1_HPP_
 #define BLAS1_HPP_
 
+#include <future>
+#include <stdint.h>
+
 // config from cmake
 #include "config.h"
+#include "context.hpp"
+#include "transport.hpp"
+#ifdef EXBLAS_MPI
+    #include <mpi.h>
+#endif
+
+namespace exblas {
+
+/**
+ * \class Request
+ * \ingroup ExSUM
+ * \brief Handle on a non-blocking merge posted by exsum_iallreduce or exdot_iallreduce.
+ *     It owns the superaccumulators in flight, so it must outlive the merge: the destructor
+ *     waits for a merge that has not completed yet. With MPI, as with any MPI request, the caller
+ *     keeps MPI progressing, e.g. by calling test, while overlapping other work
+ */
+class Request {
+public:
+    /**
+     * Construction of a handle with no pending merge, whose result is zero
+     */
+    Request();
+
+    Request(Request && other);
+    Request & operator=(Request && other);
+    ~Request();
+
+    /**
+     * Returns whether the merge has completed, without blocking
+     */
+    bool test();
+
+    /**
+     * Waits for the merge to complete
+     * \return Contains the reproducible and accurate result, the same on all the participants
+     */
+    double wait();
+
+    struct Impl;
+
+    /**
+     * Construction from an implementation. For internal use
+     */
+    explicit Request(Impl * impl);
+
+private:
+    Request(Request const &) = delete;
+    Request & operator=(Request const &) = delete;
+
+    Impl * pimpl; /**< implementation */
+};
+
+} // namespace exblas
 
 /**
  * \defgroup blas1 BLAS Level-1 Functions
@@ -34,11 +90,13 @@
  *     multi-level reproducible and accurate algorithm.
  *
  *     If fpe < 2, it uses superaccumulators only. Otherwise, it relies on 
- *     floating-point expansions of size FPE with superaccumulators when needed
+ *     floating-point expansions of size FPE with superaccumulators when needed.
+ *     Sizes above 8 use expansions of size 8; as every size gives the same result,
+ *     this and the routines below accept any fpe
  *
  * \param Ng vector size
  * \param ag vector
- * \param inca specifies the increment for the elements of a
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
  * \param offset specifies position in the vector from its start
  * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
  * \param early_exit specifies the optimization technique. By default, it is disabled
@@ -46,6 +104,349 @@
  */
 double exsum(const int Ng, double *ag, const int inca, const int offset, const int fpe, const bool early_exit = false);
 
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exsum(exblas::Context & ctx, const int Ng, double *ag, const int inca, const int offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Asynchronous summation computes the sum of elements of a real vector with our
+ *     multi-level reproducible and accurate algorithm, without waiting for the result.
+ *
+ *     The vector is split into chunks that are queued on the thread pool, so several
+ *     calls in flight share the threads. The sum is local to the calling process: it is not
+ *     merged with the other processes under MPI, nor with the participants of a transport.
+ *     Only then is it bitwise identical to the one of exsum; exsum_iallreduce leaves the
+ *     merge of a distributed sum in flight instead
+ *
+ * \param N vector size
+ * \param a vector, which must not be modified nor freed until the result is available
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offset specifies position in the vector from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Future receiving the reproducible and accurate sum of elements of a real vector
+ */
+std::future<double> exsum_async(const int N, double *a, const int inca, const int offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Techniques used by floating-point expansions. Each field enables the
+ *     corresponding parameter of FPExpansionTraits
+ */
+struct ExFPEOptions {
+    bool early_exit;        /**< stops propagating the error once it is zero in all lanes */
+    bool flush_hi;          /**< flushes the most significant component instead of the error */
+    bool horz_2sum;         /**< compacts the error across vector lanes before flushing */
+    bool check_range_first; /**< flushes inputs smaller than the expansion directly */
+    bool conditional_swap;  /**< swaps with the expansion only the nonzero lanes */
+    bool biased_2sum;       /**< uses biased 2Sum on hardware without FMA */
+    bool sort;              /**< keeps the expansion sorted by rotating its components */
+    bool victim_cache;      /**< keeps an extra component to absorb flushed errors */
+
+    /**
+     * Construction with the techniques used by default in exsum
+     */
+    ExFPEOptions() :
+        early_exit(false), flush_hi(false), horz_2sum(false), check_range_first(false),
+        conditional_swap(false), biased_2sum(true), sort(false), victim_cache(false)
+    {}
+};
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation computes the sum of elements of a real vector with our
+ *     multi-level reproducible and accurate algorithm, using floating-point expansions
+ *     of size FPE with the techniques selected in opts and superaccumulators when needed.
+ *
+ *     If fpe < 2, it uses superaccumulators only. Unless the library is built with
+ *     -DEXBLAS_FPE_VARIANTS=ON, only early_exit is taken from opts, and the other techniques
+ *     are the default ones. As all the techniques give the same result, only the speed differs.
+ *     Sizes above 8 use expansions of size 8, with the same result
+ *
+ * \param Ng vector size
+ * \param ag vector
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offset specifies position in the vector from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param opts techniques used by the floating-point expansions
+ * \return Contains the reproducible and accurate sum of elements of a real vector
+ */
+double exsum(const int Ng, double *ag, const int inca, const int offset, const int fpe, const ExFPEOptions & opts);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exsum(exblas::Context & ctx, const int Ng, double *ag, const int inca, const int offset, const int fpe, const ExFPEOptions & opts);
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation computes the sum of elements of a single-precision vector with our
+ *     multi-level reproducible and accurate algorithm. The result is correctly rounded to double precision.
+ *
+ *     The elements are widened to double as they are loaded, so no double-precision copy
+ *     of the vector is needed. If fpe < 2, it uses superaccumulators only. Otherwise, it relies on
+ *     floating-point expansions of size FPE with superaccumulators when needed
+ *
+ * \param Ng vector size
+ * \param ag vector
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offset specifies position in the vector from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate sum of elements of a single-precision vector
+ */
+double exsum(const int Ng, float *ag, const int inca, const int offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exsum(exblas::Context & ctx, const int Ng, float *ag, const int inca, const int offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation computes the sum of elements of a single-precision vector with our
+ *     multi-level reproducible and accurate algorithm. The result is correctly rounded to single precision.
+ *
+ *     If fpe < 2, it uses superaccumulators only. Otherwise, it relies on
+ *     floating-point expansions of size FPE on 8-wide single-precision vectors with superaccumulators when needed
+ *
+ * \param Ng vector size
+ * \param ag vector
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offset specifies position in the vector from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate sum of elements of a single-precision vector
+ */
+float exsumf(const int Ng, float *ag, const int inca, const int offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+float exsumf(exblas::Context & ctx, const int Ng, float *ag, const int inca, const int offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation of a real vector with 64-bit size, increment and offset,
+ *     for vectors of more than 2^31 elements. The result is the one of exsum.
+ *
+ *     Each thread processes its part of the vector in chunks of EXBLAS_CHUNK_SIZE elements,
+ *     flushing its floating-point expansions into its superaccumulator after each chunk.
+ *     With MPI, each process passes its own part of the vector, which is not scattered
+ *
+ * \param N vector size
+ * \param a vector
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offset specifies position in the vector from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate sum of elements of a real vector
+ */
+double exsum_64(const int64_t N, double *a, const int64_t inca, const int64_t offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exsum_64(exblas::Context & ctx, const int64_t N, double *a, const int64_t inca, const int64_t offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as exsumf, with 64-bit size, increment and offset as in exsum_64
+ */
+float exsumf_64(const int64_t N, float *a, const int64_t inca, const int64_t offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+float exsumf_64(exblas::Context & ctx, const int64_t N, float *a, const int64_t inca, const int64_t offset, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation of a real vector distributed over the participants of transport,
+ *     such as the processes of an MpiTransport. Each participant sums the local_n elements it owns
+ *     in place, then only the superaccumulators are exchanged: no element is moved between participants
+ *
+ * \param local_n number of elements owned by the calling participant
+ * \param local_a elements owned by the calling participant
+ * \param transport participants over which the vector is distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate sum of the whole vector on participant 0 of transport,
+ *     or on all of them with ReduceAll
+ */
+double exsum_dist(const int64_t local_n, double *local_a, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exsum_dist(exblas::Context & ctx, const int64_t local_n, double *local_a, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Non-blocking variant of exsum_dist for every participant: the local elements are summed
+ *     before returning, then the merge of the superaccumulators is started with Transport::iallreduce,
+ *     such as MPI_Iallreduce, so that the caller may overlap it with other work and computation
+ *
+ * \param local_n number of elements owned by the calling participant
+ * \param local_a elements owned by the calling participant
+ * \param transport participants over which the vector is distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Handle completed by its wait or test, giving the sum of the whole vector on all the participants
+ */
+exblas::Request exsum_iallreduce(const int64_t local_n, double *local_a, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+exblas::Request exsum_iallreduce(exblas::Context & ctx, const int64_t local_n, double *local_a, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation of several real vectors distributed alike over the participants of transport,
+ *     as exsum_dist, with the results on all the participants. The superaccumulators of all the vectors are
+ *     merged at once. With MPI, they are reduced in a single message, each one encoded by its few significant
+ *     words: a second collective is needed only for the sums whose magnitudes span too many words
+ *
+ * \param count number of vectors
+ * \param local_n number of elements of each vector owned by the calling participant
+ * \param local_a elements of each vector owned by the calling participant
+ * \param transport participants over which the vectors are distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param results reproducible and accurate sums of the whole vectors, one per vector, on all the participants
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ */
+void exsum_dist_batch(const int count, const int64_t local_n, double * const *local_a, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exsum_dist_batch(exblas::Context & ctx, const int count, const int64_t local_n, double * const *local_a, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Parallel summation of a stream of steps batches of count distributed vectors, such as one batch
+ *     per time step, with the same results as exsum_dist_batch on each batch. When the transport may merge
+ *     while the routines run, see Transport::concurrent, the threads sum batch k+1 while the calling thread
+ *     merges batch k, so that the time approaches the largest of the computation and the communication
+ *     rather than their sum. The summation is driven by a helper thread of the context, started at its
+ *     first pipeline and joined when the context is destroyed. With MPI, this requires MPI_THREAD_FUNNELED and a call from the main thread,
+ *     or MPI_THREAD_SERIALIZED or MPI_THREAD_MULTIPLE. Otherwise, the batches are summed and merged in turn
+ *
+ * \param steps number of batches
+ * \param count number of vectors per batch
+ * \param local_n number of elements of each vector owned by the calling participant
+ * \param local_a elements owned by the calling participant of vector k of batch s, at local_a[s * count + k]
+ * \param transport participants over which the vectors are distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param results reproducible and accurate sums of the whole vectors, at results[s * count + k], on all the participants
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ */
+void exsum_dist_pipeline(const int steps, const int count, const int64_t local_n, double * const *local_a, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exsum_dist_pipeline(exblas::Context & ctx, const int steps, const int count, const int64_t local_n, double * const *local_a, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+#ifdef EXBLAS_MPI
+/**
+ * \ingroup ExSUM
+ * \brief Same as exsum_dist, over the processes of comm
+ *
+ * \param comm communicator over which the vector is distributed
+ */
+double exsum_dist(const int64_t local_n, double *local_a, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exsum_dist(exblas::Context & ctx, const int64_t local_n, double *local_a, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as exsum_iallreduce, over the processes of comm, with MPI_Iallreduce
+ *
+ * \param comm communicator over which the vector is distributed
+ */
+exblas::Request exsum_iallreduce(const int64_t local_n, double *local_a, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+exblas::Request exsum_iallreduce(exblas::Context & ctx, const int64_t local_n, double *local_a, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as exsum_dist_batch, over the processes of comm, in a single compact message
+ *
+ * \param comm communicator over which the vectors are distributed
+ */
+void exsum_dist_batch(const int count, const int64_t local_n, double * const *local_a, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exsum_dist_batch(exblas::Context & ctx, const int count, const int64_t local_n, double * const *local_a, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as exsum_dist_pipeline, over the processes of comm
+ *
+ * \param comm communicator over which the vectors are distributed
+ */
+void exsum_dist_pipeline(const int steps, const int count, const int64_t local_n, double * const *local_a, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exsum_dist_pipeline(exblas::Context & ctx, const int steps, const int count, const int64_t local_n, double * const *local_a, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+#endif
+
 /**
  * \defgroup ExDOT Dot Product Functions
  * \ingroup blas1
@@ -57,14 +458,16 @@ double exsum(const int Ng, double *ag, const int inca, const int offset, const i
  *     multi-level reproducible and accurate algorithm.
  *
  *     If fpe < 3, it uses superaccumulators only. Otherwise, it relies on 
- *     floating-point expansions of size FPE with superaccumulators when needed
+ *     floating-point expansions of size FPE with superaccumulators when needed.
+ *     Sizes above 8 use expansions of size 8; as every size gives the same result,
+ *     this and the routines below accept any fpe
  *
  * \param Ng vector size
  * \param ag vector
- * \param inca specifies the increment for the elements of a
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
  * \param offseta specifies position in the vector a from its start
  * \param bg vector
- * \param incb specifies the increment for the elements of b
+ * \param incb specifies the increment for the elements of b, possibly negative as in BLAS
  * \param offsetb specifies position in the vector b from its start
  * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
  * \param early_exit specifies the optimization technique. By default, it is disabled
@@ -72,5 +475,277 @@ double exsum(const int Ng, double *ag, const int inca, const int offset, const i
  */
 double exdot(const int Ng, double *ag, const int inca, const int offseta, double *bg, const int incb, const int offsetb, const int fpe, const bool early_exit = false);
 
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exdot(exblas::Context & ctx, const int Ng, double *ag, const int inca, const int offseta, double *bg, const int incb, const int offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Asynchronous dot forms the dot product of two vectors with our
+ *     multi-level reproducible and accurate algorithm, without waiting for the result.
+ *
+ *     The vectors are split into chunks that are queued on the thread pool, so several
+ *     calls in flight share the threads. The dot product is local to the calling process: it is
+ *     not merged with the other processes under MPI, nor with the participants of a transport.
+ *     Only then is it bitwise identical to the one of exdot; exdot_iallreduce leaves the
+ *     merge of a distributed dot product in flight instead
+ *
+ * \param N vector size
+ * \param a vector, which must not be modified nor freed until the result is available
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offseta specifies position in the vector a from its start
+ * \param b vector, which must not be modified nor freed until the result is available
+ * \param incb specifies the increment for the elements of b, possibly negative as in BLAS
+ * \param offsetb specifies position in the vector b from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Future receiving the reproducible and accurate result of the dot product of two real vectors
+ */
+std::future<double> exdot_async(const int N, double *a, const int inca, const int offseta, double *b, const int incb, const int offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Parallel dot forms the dot product of two single-precision vectors with our
+ *     multi-level reproducible and accurate algorithm. The result is correctly rounded to single precision.
+ *
+ *     If fpe < 3, it uses superaccumulators only. Otherwise, it relies on
+ *     floating-point expansions of size FPE with superaccumulators when needed
+ *
+ * \param Ng vector size
+ * \param ag vector
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offseta specifies position in the vector a from its start
+ * \param bg vector
+ * \param incb specifies the increment for the elements of b, possibly negative as in BLAS
+ * \param offsetb specifies position in the vector b from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate result of the dot product of two single-precision vectors
+ */
+float exdotf(const int Ng, float *ag, const int inca, const int offseta, float *bg, const int incb, const int offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+float exdotf(exblas::Context & ctx, const int Ng, float *ag, const int inca, const int offseta, float *bg, const int incb, const int offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Parallel dot product of two real vectors with 64-bit size, increments and offsets,
+ *     for vectors of more than 2^31 elements. The result is the one of exdot.
+ *
+ *     Each thread processes its part of the vectors in chunks of EXBLAS_CHUNK_SIZE elements,
+ *     flushing its floating-point expansions into its superaccumulator after each chunk.
+ *     With MPI, each process passes its own parts of the vectors, which are not scattered
+ *
+ * \param N vector size
+ * \param a vector
+ * \param inca specifies the increment for the elements of a, possibly negative as in BLAS
+ * \param offseta specifies position in the vector a from its start
+ * \param b vector
+ * \param incb specifies the increment for the elements of b, possibly negative as in BLAS
+ * \param offsetb specifies position in the vector b from its start
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate result of the dot product of two real vectors
+ */
+double exdot_64(const int64_t N, double *a, const int64_t inca, const int64_t offseta, double *b, const int64_t incb, const int64_t offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exdot_64(exblas::Context & ctx, const int64_t N, double *a, const int64_t inca, const int64_t offseta, double *b, const int64_t incb, const int64_t offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as exdotf, with 64-bit size, increments and offsets as in exdot_64
+ */
+float exdotf_64(const int64_t N, float *a, const int64_t inca, const int64_t offseta, float *b, const int64_t incb, const int64_t offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+float exdotf_64(exblas::Context & ctx, const int64_t N, float *a, const int64_t inca, const int64_t offseta, float *b, const int64_t incb, const int64_t offsetb, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Parallel dot product of two real vectors distributed alike over the participants of transport,
+ *     such as the processes of an MpiTransport. Each participant multiplies and sums the local_n pairs
+ *     of elements it owns in place, then only the superaccumulators are exchanged: no element is moved
+ *     between participants
+ *
+ * \param local_n number of elements of each vector owned by the calling participant
+ * \param local_a elements of the first vector owned by the calling participant
+ * \param local_b elements of the second vector owned by the calling participant
+ * \param transport participants over which the vectors are distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Contains the reproducible and accurate dot product of the whole vectors on participant 0 of transport,
+ *     or on all of them with ReduceAll
+ */
+double exdot_dist(const int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exdot_dist(exblas::Context & ctx, const int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Non-blocking variant of exdot_dist for every participant: the local elements are multiplied and
+ *     summed before returning, then the merge of the superaccumulators is started with Transport::iallreduce,
+ *     so that the caller may overlap it with other work, such as the next matrix-vector product
+ *
+ * \param local_n number of elements of each vector owned by the calling participant
+ * \param local_a elements of the first vector owned by the calling participant
+ * \param local_b elements of the second vector owned by the calling participant
+ * \param transport participants over which the vectors are distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return Handle completed by its wait or test, giving the dot product of the whole vectors on all the participants
+ */
+exblas::Request exdot_iallreduce(const int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+exblas::Request exdot_iallreduce(exblas::Context & ctx, const int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Parallel dot products of several pairs of real vectors distributed alike over the participants
+ *     of transport, as exdot_dist, with the results on all the participants. The superaccumulators of all
+ *     the pairs are merged at once, as in exsum_dist_batch, e.g. for the several dot products
+ *     of an iteration of a Krylov method
+ *
+ * \param count number of pairs of vectors
+ * \param local_n number of elements of each vector owned by the calling participant
+ * \param local_a elements of the first vector of each pair owned by the calling participant
+ * \param local_b elements of the second vector of each pair owned by the calling participant
+ * \param transport participants over which the vectors are distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param results reproducible and accurate dot products of the whole vectors, one per pair, on all the participants
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ */
+void exdot_dist_batch(const int count, const int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exdot_dist_batch(exblas::Context & ctx, const int count, const int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Parallel dot products of a stream of steps batches of count pairs of distributed vectors,
+ *     with the same results as exdot_dist_batch on each batch, pipelined as in exsum_dist_pipeline
+ *
+ * \param steps number of batches
+ * \param count number of pairs of vectors per batch
+ * \param local_n number of elements of each vector owned by the calling participant
+ * \param local_a elements of the first vector of pair k of batch s owned by the calling participant, at local_a[s * count + k]
+ * \param local_b elements of the second vector of pair k of batch s owned by the calling participant, at local_b[s * count + k]
+ * \param transport participants over which the vectors are distributed
+ * \param fpe stands for the floating-point expansions size (used in conjuction with superaccumulators)
+ * \param results reproducible and accurate dot products of the whole vectors, at results[s * count + k], on all the participants
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ */
+void exdot_dist_pipeline(const int steps, const int count, const int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exdot_dist_pipeline(exblas::Context & ctx, const int steps, const int count, const int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, const int fpe, double *results, const bool early_exit = false);
+
+#ifdef EXBLAS_MPI
+/**
+ * \ingroup ExDOT
+ * \brief Same as exdot_dist, over the processes of comm
+ *
+ * \param comm communicator over which the vectors are distributed
+ */
+double exdot_dist(const int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+double exdot_dist(exblas::Context & ctx, const int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as exdot_iallreduce, over the processes of comm, with MPI_Iallreduce
+ *
+ * \param comm communicator over which the vectors are distributed
+ */
+exblas::Request exdot_iallreduce(const int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+exblas::Request exdot_iallreduce(exblas::Context & ctx, const int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as exdot_dist_batch, over the processes of comm, in a single compact message
+ *
+ * \param comm communicator over which the vectors are distributed
+ */
+void exdot_dist_batch(const int count, const int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exdot_dist_batch(exblas::Context & ctx, const int count, const int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as exdot_dist_pipeline, over the processes of comm
+ *
+ * \param comm communicator over which the vectors are distributed
+ */
+void exdot_dist_pipeline(const int steps, const int count, const int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+
+/**
+ * \ingroup ExDOT
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+void exdot_dist_pipeline(exblas::Context & ctx, const int steps, const int count, const int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, const int fpe, double *results, const bool early_exit = false);
+#endif
+
 #endif // BLAS1_HPP_
 
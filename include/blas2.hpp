@@ -19,6 +19,12 @@
 // config from cmake
 #include "config.h"
 
+#include "context.hpp"
+#include "transport.hpp"
+#ifdef EXBLAS_MPI
+    #include <mpi.h>
+#endif
+
 /**
  * \defgroup blas2 BLAS Level-2 Functions
  */
@@ -72,7 +78,8 @@ int extrsv(const char uplo, const char transa, const char diag, const int n, dou
  *  a matrix and a vector are composed of real numbers.
  *
  *  If fpe < 3, it relies on superaccumulators only. Otherwise, it relies on 
- *  floating-point expansions of size FPE with superaccumulators when needed
+ *  floating-point expansions of size FPE with superaccumulators when needed.
+ *  Sizes above 8 use expansions of size 8, with the same result
  *
  * \param transa 'T' or 'N' a transpose or a non-transpose matrix A
  * \param m the number of rows of matrix A
@@ -94,5 +101,73 @@ int extrsv(const char uplo, const char transa, const char diag, const int n, dou
  */
 int exgemv(const char transa, const int m, const int n, const double alpha, double *a, const int lda, const int offseta, double *x, const int incx, const int offsetx, const double beta, double *y, const int incy, const int offsety, const int fpe, const bool early_exit = false);
 
+/**
+ * \ingroup ExGEMV
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+int exgemv(exblas::Context & ctx, const char transa, const int m, const int n, const double alpha, double *a, const int lda, const int offseta, double *x, const int incx, const int offsetx, const double beta, double *y, const int incy, const int offsety, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExGEMV
+ * \brief ExGEMV on a matrix distributed over the participants of transport, such as the
+ *  processes of an MpiTransport. Each participant holds a submatrix of A: its local_m rows
+ *  and local_n columns are the rows rows[] and the columns cols[] of A, and every element
+ *  of A belongs to exactly one participant. Contiguous rows give the 1D row-block layout,
+ *  and the indices of the blocks of a process give the 2D block-cyclic layout of a process grid.
+ *
+ *  When every participant holds whole rows of A (whole columns with transa = 'T'), as in the
+ *  1D row-block layout, it rounds its elements of y alone. Otherwise, the superaccumulators of
+ *  the elements of y are merged exactly by a reduce-scatter, each participant rounding a block
+ *  of them. Only the rounded elements are then gathered, so that y is the same on all the
+ *  participants and bitwise identical whatever the distribution of A and the number of participants
+ *
+ * \param transa 'T' or 'N' a transpose or a non-transpose matrix A
+ * \param m the number of rows of matrix A
+ * \param n the number of columns of matrix A
+ * \param local_m the number of rows of the local submatrix
+ * \param rows global indices of the rows of the local submatrix, or null for the first local_m ones
+ * \param local_n the number of columns of the local submatrix
+ * \param cols global indices of the columns of the local submatrix, or null for the first local_n ones
+ * \param alpha scalar
+ * \param a local submatrix, column-major
+ * \param lda leading dimension of the local submatrix
+ * \param x whole vector x, on every participant
+ * \param beta scalar
+ * \param y whole vector y, on every participant, overwritten by the result
+ * \param transport participants among which A is distributed
+ * \param fpe size of floating-point expansion
+ * \param early_exit specifies the optimization technique. By default, it is disabled
+ * \return 0; y contains the reproducible and accurate result on all the participants
+ */
+int exgemv_dist(const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExGEMV
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+int exgemv_dist(exblas::Context & ctx, const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, exblas::Transport & transport, const int fpe, const bool early_exit = false);
+
+#ifdef EXBLAS_MPI
+/**
+ * \ingroup ExGEMV
+ * \brief Same as exgemv_dist, over the processes of comm
+ *
+ * \param comm processes among which A is distributed
+ */
+int exgemv_dist(const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, MPI_Comm comm, const int fpe, const bool early_exit = false);
+
+/**
+ * \ingroup ExGEMV
+ * \brief Same as above, within the execution context ctx instead of the default one
+ *
+ * \param ctx execution context
+ */
+int exgemv_dist(exblas::Context & ctx, const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, MPI_Comm comm, const int fpe, const bool early_exit = false);
+#endif
+
 #endif // BLAS2_HPP_
 
@@ -42,6 +42,30 @@ int constexpr f_bits = 1023 + 52;   // 300
  */
 int constexpr bin_count = 39;
 
+/**
+ * \ingroup common
+ * \brief Maximum exponent in single precision
+ */
+int constexpr e_bits_f = 127;
+
+/**
+ * \ingroup common
+ * \brief Maximum exponent + the number of bits in signigicant in single precision
+ */
+int constexpr f_bits_f = 127 + 23;
+
+/**
+ * \ingroup common
+ * \brief Maximum exponent of a product of two single-precision numbers
+ */
+int constexpr e_bits_fdot = 2 * 128;
+
+/**
+ * \ingroup common
+ * \brief Maximum exponent + the number of bits in signigicant of a product of two single-precision numbers
+ */
+int constexpr f_bits_fdot = 2 * (127 + 23);
+
 
 /**
  * \ingroup common
@@ -0,0 +1,225 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file context.hpp
+ *  \brief Provides the execution context shared by the ExBLAS routines
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef CONTEXT_HPP_
+#define CONTEXT_HPP_
+
+#include <stdint.h>
+
+namespace exblas {
+
+class Transport;
+
+/**
+ * \defgroup context Execution Context
+ */
+
+/**
+ * \ingroup context
+ * \brief How the routines take the NUMA placement of their input into account
+ */
+enum NumaPolicy {
+    NumaOff,     /**< threads are neither bound nor grouped by NUMA node (default) */
+    NumaDetect,  /**< the placement of the input pages is detected at each call */
+    NumaBlocked  /**< hint: the input is split among the NUMA nodes as done by numa_first_touch */
+};
+
+/**
+ * \ingroup context
+ * \brief Number of threads selecting the smallest team that saturates the memory bandwidth,
+ *     measured once per process
+ */
+int const AutoThreads = -1;
+
+/**
+ * \ingroup context
+ * \brief Which hardware threads run the threads of a context, and whether they are pinned
+ */
+enum Placement {
+    PlacementDefault, /**< the placement named by the EXBLAS_PLACEMENT environment variable
+                           (none, cores, or threads), otherwise PlacementNone */
+    PlacementNone,    /**< the threads are not pinned and the system may migrate them */
+    PlacementCores,   /**< one thread per physical core, pinned to it: SMT siblings are left idle */
+    PlacementThreads  /**< threads pinned to hardware threads, the first one of each core
+                           being filled before the SMT siblings */
+};
+
+/**
+ * \ingroup context
+ * \brief How the input is distributed among the threads of a context
+ */
+enum Schedule {
+    ScheduleStatic,  /**< each thread processes one contiguous part of the input (default) */
+    ScheduleDynamic  /**< the threads claim fixed-size chunks of the input until none is left,
+                          so that faster or less loaded cores process more of them */
+};
+
+/**
+ * \ingroup context
+ * \brief Which processes receive the result of the routines with MPI
+ */
+enum Reduce {
+    ReduceRoot, /**< the result is significant on rank 0 only (default) */
+    ReduceAll   /**< every rank receives the same result, the superaccumulators being combined
+                     by a single allreduce instead of a reduction followed by a broadcast */
+};
+
+/**
+ * \ingroup context
+ * \brief Threading backend running the parallel parts of all the CPU routines
+ */
+enum Backend {
+    BackendDefault, /**< the backend named by the EXBLAS_BACKEND environment variable
+                         (openmp, tbb, or threads), otherwise OpenMP if compiled in */
+    BackendOpenMP,  /**< OpenMP threads */
+    BackendTBB,     /**< Intel TBB workers */
+    BackendThreads  /**< persistent std::thread pool */
+};
+
+/**
+ * \ingroup context
+ * \brief Selects the threading backend. There is a single thread pool per process, shared by
+ *     all the contexts, so the backend must be selected before the first context is created
+ *
+ * \param backend threading backend
+ * \return false if the backend is not compiled in, or if another backend already runs
+ */
+bool set_backend(Backend backend);
+
+/**
+ * \ingroup context
+ * \brief Returns the threading backend in use, starting it if needed
+ */
+Backend get_backend();
+
+/**
+ * \class Context
+ * \ingroup context
+ * \brief Owns the threads, the per-thread superaccumulators and the scratch memory
+ *  used by the routines, so that they are set up once instead of at every call.
+ *
+ *  A context may be passed to several routines one after another, but not to
+ *  concurrent calls: each calling thread should have its own context
+ */
+class Context {
+public:
+    /**
+     * Construction. With pinning, the threads of the pool are bound to their hardware thread
+     * during each call, except for the calling thread, which runs the first thread of the team.
+     * Pinning requires a backend that keeps the same thread for each position, i.e. not TBB
+     * \param nthreads number of threads; AutoThreads sizes the team after the memory bandwidth,
+     *     and 0 selects the number set by the EXBLAS_NUM_THREADS environment variable (a number or auto),
+     *     otherwise all the available threads, or all the available cores with PlacementCores
+     * \param placement placement of the threads
+     * \param cpus if not null, list of the CPUs to pin the threads to, such as "0-7,16-23"; otherwise
+     *     the ones set by the EXBLAS_CPUS environment variable, or else all the CPUs the process may run on
+     */
+    explicit Context(int nthreads = 0, Placement placement = PlacementDefault, char const * cpus = 0);
+
+    ~Context();
+
+    /**
+     * Returns the number of threads used by the routines
+     */
+    int get_num_threads() const;
+
+    /**
+     * Selects how the NUMA placement of the input is taken into account. Unless it is NumaOff,
+     * the threads of the pool are bound to NUMA nodes during each call, each group of threads
+     * processes the part of the input placed on its node, and the superaccumulators are merged
+     * within each node before across nodes
+     * \param policy NUMA policy
+     */
+    void set_numa_policy(NumaPolicy policy);
+
+    /**
+     * Selects how the input is distributed among the threads. With ScheduleDynamic, each chunk
+     * is accumulated by its own floating-point expansions into the superaccumulator of the thread
+     * that claimed it. As the superaccumulators are exact, the results do not depend on the schedule
+     * \param schedule distribution of the input
+     * \param chunk number of elements per chunk with ScheduleDynamic; 0 selects the default size
+     */
+    void set_schedule(Schedule schedule, int64_t chunk = 0);
+
+    /**
+     * Selects which processes receive the result with MPI, and which participants receive the one of
+     * exsum_dist and exdot_dist. As the superaccumulators are merged exactly, all the ranks round the same
+     * value with ReduceAll, whatever the order in which they combine it. The participants of the transport
+     * of the context always all receive the result
+     * \param reduce processes receiving the result
+     */
+    void set_reduce(Reduce reduce);
+
+    /**
+     * Merges the results of the routines with the other participants of transport instead of MPI:
+     * each participant calls the routines on its own part of the input, which is not scattered,
+     * and all of them receive the result over all the parts
+     * \param transport participant of a group, kept by the caller while the context uses it;
+     *     null restores the default reduction
+     */
+    void set_transport(Transport * transport);
+
+    struct Impl;
+
+    /**
+     * Returns the implementation of the context. For internal use
+     */
+    Impl & impl() { return *pimpl; }
+
+private:
+    Context(Context const &) = delete;
+    Context & operator=(Context const &) = delete;
+
+    Impl * pimpl; /**< implementation */
+};
+
+/**
+ * \ingroup context
+ * \brief Returns the context used by the routines called without one.
+ *     There is one such context per calling thread, created at its first call: a context
+ *     serves one call at a time, so threads calling the routines concurrently without a
+ *     context of their own each get theirs instead of sharing one. Its threads come from
+ *     the pool of the process, so only its superaccumulators and scratch memory are per
+ *     thread. Threads calling the routines once in a while may pass their own context
+ *     to the overloads taking one, to release that memory when they want. The
+ *     asynchronous routines take none, as they keep their state per call
+ */
+Context & default_context();
+
+/**
+ * \ingroup context
+ * \brief Initializes a vector to zero in parallel, so that each part of it is placed
+ *     on the NUMA node of the threads of ctx that will process it
+ *
+ * \param ctx execution context
+ * \param N vector size
+ * \param a vector
+ */
+void numa_first_touch(Context & ctx, int64_t N, double *a);
+
+/**
+ * \ingroup context
+ * \brief Initializes a single-precision vector to zero in parallel, so that each part of it
+ *     is placed on the NUMA node of the threads of ctx that will process it
+ *
+ * \param ctx execution context
+ * \param N vector size
+ * \param a vector
+ */
+void numa_first_touch(Context & ctx, int64_t N, float *a);
+
+} // namespace exblas
+
+#endif // CONTEXT_HPP_
@@ -0,0 +1,234 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file transport.hpp
+ *  \brief Provides the transports merging the superaccumulators of several participants,
+ *         such as processes or threads each holding a part of the input
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef TRANSPORT_HPP_
+#define TRANSPORT_HPP_
+
+#include <stdint.h>
+
+#ifdef EXBLAS_MPI
+    #include <mpi.h>
+#endif
+
+namespace exblas {
+
+/**
+ * \defgroup transport Reduction Transports
+ */
+
+/**
+ * \class Transport
+ * \ingroup transport
+ * \brief Merges the superaccumulators of a group of participants. Once a context is given
+ *  a transport with Context::set_transport, each participant calls the routines on its
+ *  own part of the input and receives the result over all the parts.
+ *
+ *  Superaccumulators are exchanged as their carry-save words, which any participant
+ *  may add up in any order: the merged words are exact, so that every participant rounds
+ *  the same result
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    /**
+     * Returns the position of the participant in its group, from 0
+     */
+    virtual int get_rank() const = 0;
+
+    /**
+     * Returns the number of participants of the group
+     */
+    virtual int get_size() const = 0;
+
+    /**
+     * Replaces count superaccumulators of words words each by their sums over all the participants,
+     * on every participant. All the participants call it in the same order with the same sizes
+     * \param acc normalized carry-save words of the superaccumulators, one after another
+     * \param words number of words of each superaccumulator
+     * \param count number of superaccumulators
+     */
+    virtual void allreduce(int64_t * acc, int words, int count) = 0;
+
+    /**
+     * Same as allreduce, with the sums needed on participant 0 only: the words of the others
+     * are left unspecified. By default, it is allreduce
+     */
+    virtual void reduce(int64_t * acc, int words, int count);
+
+    /**
+     * Same as allreduce, with the superaccumulators split in blocks of counts[r] ones, one per participant:
+     * participant r receives the sums of the superaccumulators of block r only, at the start of acc.
+     * By default, it is allreduce
+     * \param acc normalized carry-save words of the superaccumulators of all the blocks, one after another
+     * \param words number of words of each superaccumulator
+     * \param counts number of superaccumulators of the block of each participant
+     */
+    virtual void reduce_scatter(int64_t * acc, int words, int const * counts);
+
+    /**
+     * Gathers the blocks of counts[r] words of the participants r, one after another in values,
+     * on every participant. Each participant fills its own block beforehand.
+     * All the participants call it in the same order with the same counts
+     * \param values blocks of all the participants
+     * \param counts number of words of the block of each participant
+     */
+    virtual void allgather(int64_t * values, int const * counts) = 0;
+
+    /**
+     * \class Pending
+     * \brief Merge in flight started by iallreduce
+     */
+    class Pending {
+    public:
+        virtual ~Pending() {}
+
+        /**
+         * Returns whether the merge has completed, without blocking
+         */
+        virtual bool test() = 0;
+
+        /**
+         * Waits for the merge to complete
+         */
+        virtual void wait() = 0;
+    };
+
+    /**
+     * Starts allreduce on a single superaccumulator without waiting for the other participants.
+     * By default, the merge completes before returning
+     * \param acc normalized carry-save words of the superaccumulator, kept until the merge completes
+     * \param words number of words of the superaccumulator
+     * \return Merge in flight, deleted by the caller once completed, or null if it has already completed
+     */
+    virtual Pending * iallreduce(int64_t * acc, int words);
+
+    /**
+     * Returns whether allreduce may be called while another thread of the process runs the routines,
+     * so that merging a batch overlaps the computation of the next one. By default, it may
+     */
+    virtual bool concurrent() const;
+};
+
+/**
+ * \class LoopbackTransport
+ * \ingroup transport
+ * \brief Participants within the calling process, such as threads or the tasks of a service.
+ *  A group of a single participant leaves the superaccumulators unchanged
+ */
+class LoopbackTransport : public Transport {
+public:
+    /**
+     * Creates a group of participants and returns its participant 0
+     * \param size number of participants
+     */
+    explicit LoopbackTransport(int size = 1);
+
+    /**
+     * Returns the participant rank of the group of other, to be used by another thread
+     * \param other any participant of the group
+     * \param rank position of the participant, in [1, size)
+     */
+    LoopbackTransport(LoopbackTransport const & other, int rank);
+
+    ~LoopbackTransport();
+
+    int get_rank() const;
+    int get_size() const;
+    void allreduce(int64_t * acc, int words, int count);
+    void allgather(int64_t * values, int const * counts);
+
+    struct Impl;
+
+private:
+    LoopbackTransport(LoopbackTransport const &) = delete;
+    LoopbackTransport & operator=(LoopbackTransport const &) = delete;
+
+    Impl * pimpl; /**< implementation */
+};
+
+/**
+ * \class SharedTransport
+ * \ingroup transport
+ * \brief Processes of a single machine, merging their superaccumulators through a POSIX
+ *  shared-memory segment without any launcher. The construction waits for all the participants
+ */
+class SharedTransport : public Transport {
+public:
+    /**
+     * Construction. The segment is created by rank 0 and removed once all the participants are attached.
+     * A segment of the same name left over by a group whose rank 0 has ended is replaced
+     * \param name name of the segment, such as "/exblas-job42", unique to the group
+     * \param rank position of the calling process, in [0, size)
+     * \param size number of participants
+     */
+    SharedTransport(char const * name, int rank, int size);
+
+    ~SharedTransport();
+
+    /**
+     * Returns whether the participant is attached to the segment. Otherwise, as when rank 0 cannot
+     * create the segment or a running group uses its name, the transport must not be used
+     */
+    bool is_open() const;
+
+    int get_rank() const;
+    int get_size() const;
+    void allreduce(int64_t * acc, int words, int count);
+    void allgather(int64_t * values, int const * counts);
+
+    struct Impl;
+
+private:
+    SharedTransport(SharedTransport const &) = delete;
+    SharedTransport & operator=(SharedTransport const &) = delete;
+
+    Impl * pimpl; /**< implementation */
+};
+
+#ifdef EXBLAS_MPI
+/**
+ * \class MpiTransport
+ * \ingroup transport
+ * \brief Processes of an MPI communicator, merging their superaccumulators with MPI collectives.
+ *  A single superaccumulator is merged within each node first with EXBLAS_MPI_HIERARCHICAL;
+ *  several ones are sent in a single message with a compact encoding of their significant words
+ */
+class MpiTransport : public Transport {
+public:
+    /**
+     * Construction
+     * \param comm processes of the group
+     */
+    explicit MpiTransport(MPI_Comm comm = MPI_COMM_WORLD);
+
+    int get_rank() const;
+    int get_size() const;
+    void allreduce(int64_t * acc, int words, int count);
+    void reduce(int64_t * acc, int words, int count);
+    void reduce_scatter(int64_t * acc, int words, int const * counts);
+    void allgather(int64_t * values, int const * counts);
+    Pending * iallreduce(int64_t * acc, int words);
+    bool concurrent() const;
+
+private:
+    MPI_Comm comm; /**< processes of the group */
+};
+#endif
+
+} // namespace exblas
+
+#endif // TRANSPORT_HPP_
@@ -0,0 +1,376 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#include "ExContext.hpp"
+#include "ExNUMA.hpp"
+
+
+// Returns the placement named by the EXBLAS_PLACEMENT environment variable
+static exblas::Placement ReadEnvPlacement()
+{
+    char const * env = getenv("EXBLAS_PLACEMENT");
+    if (!env || !strcmp(env, "none"))
+        return exblas::PlacementNone;
+    if (!strcmp(env, "cores"))
+        return exblas::PlacementCores;
+    if (!strcmp(env, "threads"))
+        return exblas::PlacementThreads;
+    fprintf(stderr, "Unknown placement EXBLAS_PLACEMENT=%s, the threads are not pinned\n", env);
+    return exblas::PlacementNone;
+}
+
+static exblas::Placement EnvPlacement()
+{
+    static exblas::Placement const placement = ReadEnvPlacement();
+    return placement;
+}
+
+// Returns the hardware thread of each thread to pin, grouped by NUMA node: within a node, the first
+// hardware thread of each core, then with PlacementThreads the second one of each core, and so on
+static std::vector<int> PinnedCpus(exblas::Placement placement, char const * cpulist)
+{
+    std::vector<int> cpus;
+    if (placement == exblas::PlacementNone)
+        return cpus;
+    std::vector<std::vector<int> > cores = ExCpuCores(cpulist ? cpulist : getenv("EXBLAS_CPUS"));
+    size_t levels = (placement == exblas::PlacementCores) ? 1 : 0;
+    for (size_t c = 0; (placement == exblas::PlacementThreads) && (c != cores.size()); ++c)
+        levels = std::max(levels, cores[c].size());
+    for (size_t first = 0, last; first != cores.size(); first = last) {
+        int node = ExCpuNode(cores[first][0]);
+        for (last = first; (last != cores.size()) && (ExCpuNode(cores[last][0]) == node); ++last)
+            ;
+        for (size_t level = 0; level != levels; ++level)
+            for (size_t c = first; c != last; ++c)
+                if (level < cores[c].size())
+                    cpus.push_back(cores[c][level]);
+    }
+    return cpus;
+}
+
+// Returns the read bandwidth of the memory in bytes per second with tnum threads of the pool
+static double ReadBandwidth(ExThreadPool & pool, int tnum, std::vector<double> const & buffer)
+{
+    int64_t n = buffer.size();
+    std::vector<double> sums(tnum * exblas::Context::Impl::linesize);
+    double best = 0;
+    for (int rep = 0; rep != 3; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        pool.Parallel(tnum, [&](int tid, int tnum) {
+            int64_t l = (n * tid) / tnum, r = (n * (tid + 1)) / tnum;
+            double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (int64_t i = l; i + 4 <= r; i += 4) {
+                s0 += buffer[i];
+                s1 += buffer[i+1];
+                s2 += buffer[i+2];
+                s3 += buffer[i+3];
+            }
+            sums[tid * exblas::Context::Impl::linesize] = s0 + s1 + s2 + s3;
+        });
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        best = std::max(best, n * sizeof(double) / t);
+    }
+    return best;
+}
+
+// Returns the smallest number of threads, up to maxthreads, whose read bandwidth is within 10%
+// of the best one. The bandwidth is measured once, for growing numbers of threads
+static int BandwidthThreads(ExThreadPool & pool, int maxthreads)
+{
+    static std::once_flag measured;
+    static std::vector<std::pair<int, double> > bandwidth;
+    std::call_once(measured, [&pool] {
+        int hw = std::max<int>(std::thread::hardware_concurrency(), 1);
+        // Much larger than the caches
+        std::vector<double> buffer(int64_t(8) << 20);
+        pool.Parallel(hw, [&](int tid, int tnum) {
+            int64_t n = buffer.size();
+            std::fill(buffer.begin() + (n * tid) / tnum, buffer.begin() + (n * (tid + 1)) / tnum, 1.);
+        });
+        for (int t = 1; ; t = std::min(std::max(t + 1, t * 5 / 4), hw)) {
+            bandwidth.push_back(std::make_pair(t, ReadBandwidth(pool, t, buffer)));
+            if (t == hw)
+                break;
+        }
+    });
+    double best = 0;
+    for (size_t i = 0; (i != bandwidth.size()) && (bandwidth[i].first <= maxthreads); ++i)
+        best = std::max(best, bandwidth[i].second);
+    for (size_t i = 0; (i != bandwidth.size()) && (bandwidth[i].first <= maxthreads); ++i)
+        if (bandwidth[i].second >= 0.9 * best)
+            return bandwidth[i].first;
+    return 1;
+}
+
+// Returns the number of threads of a team from the nthreads argument of the context,
+// the EXBLAS_NUM_THREADS environment variable, and the hardware threads to pin to
+static int TeamSize(ExThreadPool & pool, int nthreads, std::vector<int> const & cpus)
+{
+    if (nthreads == 0) {
+        char const * env = getenv("EXBLAS_NUM_THREADS");
+        if (env)
+            nthreads = strcmp(env, "auto") ? atoi(env) : exblas::AutoThreads;
+    }
+    int available = cpus.empty() ? pool.MaxThreads() : cpus.size();
+    if (nthreads == exblas::AutoThreads)
+        return BandwidthThreads(pool, available);
+    return (nthreads > 0) ? nthreads : available;
+}
+
+exblas::Context::Impl::Impl(int nthreads, Placement placement, char const * cpulist) :
+    pool(ExPool()),
+    cpus(PinnedCpus((placement == PlacementDefault) ? EnvPlacement() : placement, cpulist)),
+    nthreads(TeamSize(pool, nthreads, cpus)),
+    arrived(this->nthreads * linesize, 0),
+    reduce(ReduceRoot),
+    transport(0),
+    numa_policy(NumaOff),
+    active_groups(1),
+    thread_group(this->nthreads),
+    segments(2, 0),
+    schedule(ScheduleStatic),
+    chunk(EXBLAS_DYNAMIC_CHUNK),
+    step(EXBLAS_DYNAMIC_CHUNK)
+{
+    if (!cpus.empty() && (this->nthreads <= int(cpus.size()))) {
+        // Pinned threads are grouped by the NUMA node of their hardware thread
+        for (int t = 0; t != this->nthreads; ++t) {
+            int node = ExCpuNode(cpus[t]);
+            if (group_node.empty() || (group_node.back() != node)) {
+                group_node.push_back(node);
+                group_first.push_back(t);
+            }
+            thread_group[t] = group_node.size() - 1;
+        }
+        ngroups = group_node.size();
+        group_first.push_back(this->nthreads);
+    } else {
+        // Threads are split evenly among the NUMA nodes, in order
+        ngroups = std::min<int>(ExNumaNodes().size(), this->nthreads);
+        group_first.resize(ngroups + 1);
+        for (int g = 0; g <= ngroups; ++g)
+            group_first[g] = (g * this->nthreads) / ngroups;
+        for (int g = 0; g != ngroups; ++g) {
+            group_node.push_back(g);
+            for (int t = group_first[g]; t != group_first[g+1]; ++t)
+                thread_group[t] = g;
+        }
+    }
+    group_arrived.assign(ngroups * linesize, 0);
+    next.assign(ngroups * linesize / 2, 0);
+    deferred = false;
+
+    // Start the threads now rather than at the first call, unless nested calls will run serially
+    if (!pool.InParallel())
+        pool.Parallel(this->nthreads, [](int, int) {});
+}
+
+bool exblas::Context::Impl::Serial(int64_t count) const
+{
+    return (nthreads == 1) || (count < EXBLAS_SERIAL_THRESHOLD) || pool.InParallel();
+}
+
+void exblas::Context::Impl::Prepare(Superaccumulator const & zero)
+{
+    // Copying reuses the memory of the superaccumulators when their ranges match
+    acc.resize(nthreads);
+    for (int i = 0; i != nthreads; ++i)
+        acc[i] = zero;
+    std::fill(arrived.begin(), arrived.end(), 0);
+    std::fill(group_arrived.begin(), group_arrived.end(), 0);
+}
+
+static int64_t RoundDown(int64_t x, int64_t align)
+{
+    return x - x % align;
+}
+
+void exblas::Context::Impl::PartitionBlocked(int64_t count, ptrdiff_t stride, int align)
+{
+    active_groups = ngroups;
+    segments.resize(ngroups + 1);
+    // Parts start on page boundaries
+    int64_t page = std::max<int64_t>(sysconf(_SC_PAGESIZE) / std::max<int64_t>(std::abs(stride), 1), 1);
+    int64_t unit = (page + align - 1) / align * align;
+    for (int g = 0; g != ngroups; ++g)
+        segments[g] = RoundDown((count * group_first[g]) / nthreads, unit);
+    segments[ngroups] = count;
+}
+
+void exblas::Context::Impl::Partition(int64_t count, void const * a, ptrdiff_t stride, int align)
+{
+    if ((numa_policy == NumaOff) || (ngroups == 1)) {
+        active_groups = 1;
+        segments.resize(2);
+        segments[0] = 0;
+        segments[1] = count;
+        return;
+    }
+    PartitionBlocked(count, stride, align);
+    if (numa_policy == NumaBlocked)
+        return;
+
+    // Sample the placement of the input, which is expected to be split in
+    // contiguous parts in the order of the nodes as after numa_first_touch
+    int const samples = 16 * ngroups;
+    std::vector<void const *> pages(samples);
+    std::vector<int64_t> pos(samples);
+    std::vector<int> nodes(samples);
+    for (int k = 0; k != samples; ++k) {
+        pos[k] = (count * k) / samples;
+        pages[k] = (char const *)a + pos[k] * stride;
+    }
+    if (!ExPageNodes(samples, &pages[0], &nodes[0]))
+        return;
+    // From NUMA nodes to groups of threads
+    std::vector<int> node_group(ExNumaNodes().size(), -1);
+    for (int g = 0; g != ngroups; ++g)
+        node_group[group_node[g]] = g;
+    for (int k = 0; k != samples; ++k)
+        nodes[k] = (nodes[k] < 0) ? -1 : node_group[nodes[k]];
+    std::vector<int64_t> detected(ngroups + 1, -1);
+    detected[0] = 0;
+    detected[ngroups] = count;
+    for (int k = 0; k != samples; ++k) {
+        if ((nodes[k] < 0) || ((k > 0) && (nodes[k] < nodes[k-1])))
+            return;     // Unknown or not in the order of the nodes: keep the blocked split
+        for (int g = (k > 0) ? nodes[k-1] + 1 : 1; g <= nodes[k]; ++g)
+            detected[g] = RoundDown(pos[k], align);
+    }
+    for (int g = 0; g != ngroups; ++g) {
+        if ((detected[g+1] < 0) || (detected[g+1] <= detected[g]))
+            return;     // A node holds no part of the input: keep the blocked split
+    }
+    segments = detected;
+}
+
+void exblas::Context::Impl::ThreadRange(unsigned int tid, unsigned int tnum, int align, int64_t & l, int64_t & r) const
+{
+    int64_t L = 0, R = segments[active_groups];
+    int64_t local = tid, cnt = tnum;
+    if ((active_groups > 1) && (int(tnum) == nthreads)) {
+        int g = thread_group[tid];
+        L = segments[g];
+        R = segments[g+1];
+        local = tid - group_first[g];
+        cnt = group_first[g+1] - group_first[g];
+    }
+    l = RoundDown(L + (local * (R - L)) / cnt, align);
+    // The last thread of each group also takes the elements left over by the rounding
+    r = (local + 1 == cnt) ? R : RoundDown(L + ((local + 1) * (R - L)) / cnt, align);
+}
+
+void exblas::Context::Impl::PrepareChunks(int align)
+{
+    step = (chunk + align - 1) / align * align;
+    for (int g = 0; g != active_groups; ++g)
+        next[g * linesize / 2] = segments[g];
+}
+
+bool exblas::Context::Impl::NextChunk(int g, int64_t & l, int64_t & r)
+{
+    // Chunks are only claimed: the reduction tree orders the accumulations
+    l = __atomic_fetch_add(&next[g * linesize / 2], step, __ATOMIC_RELAXED);
+    if (l >= segments[g+1])
+        return false;
+    r = std::min(l + step, segments[g+1]);
+    return true;
+}
+
+int exblas::Context::Impl::ThreadGroup(unsigned int tid, unsigned int tnum) const
+{
+    return ((active_groups > 1) && (int(tnum) == nthreads)) ? thread_group[tid] : 0;
+}
+
+bool exblas::Context::Impl::Bind(unsigned int tid, unsigned int tnum, ExAffinity & saved)
+{
+    // The calling thread runs tid 0 and belongs to the application
+    if ((tid == 0) || (int(tnum) != nthreads) || !pool.StableThreads())
+        return false;
+    if (!cpus.empty()) {
+        saved.Save();
+        ExBindToCpu(cpus[tid % cpus.size()]);
+        return true;
+    }
+    if (active_groups > 1) {
+        saved.Save();
+        ExBindToNode(group_node[thread_group[tid]]);
+        return true;
+    }
+    return false;
+}
+
+exblas::Context::Context(int nthreads, Placement placement, char const * cpus) :
+    pimpl(new Impl(nthreads, placement, cpus))
+{
+}
+
+exblas::Context::~Context()
+{
+    delete pimpl;
+}
+
+int exblas::Context::get_num_threads() const
+{
+    return pimpl->nthreads;
+}
+
+void exblas::Context::set_numa_policy(NumaPolicy policy)
+{
+    pimpl->numa_policy = policy;
+}
+
+void exblas::Context::set_schedule(Schedule schedule, int64_t chunk)
+{
+    pimpl->schedule = schedule;
+    pimpl->chunk = (chunk > 0) ? chunk : EXBLAS_DYNAMIC_CHUNK;
+}
+
+void exblas::Context::set_reduce(Reduce reduce)
+{
+    pimpl->reduce = reduce;
+}
+
+void exblas::Context::set_transport(Transport * transport)
+{
+    pimpl->transport = transport;
+}
+
+exblas::Context & exblas::default_context()
+{
+    static thread_local Context ctx;
+    return ctx;
+}
+
+template<typename T>
+static void FirstTouch(exblas::Context::Impl & ctx, int64_t N, T *a)
+{
+    ctx.PartitionBlocked(N, sizeof(T), 1);
+    ctx.pool.Parallel(ctx.nthreads, [&](unsigned int tid, unsigned int tnum) {
+        ExBinding binding(ctx, tid, tnum);
+        int64_t l, r;
+        ctx.ThreadRange(tid, tnum, 1, l, r);
+        memset(a + l, 0, (r - l) * sizeof(T));
+    });
+}
+
+void exblas::numa_first_touch(Context & ctx, int64_t N, double *a)
+{
+    FirstTouch(ctx.impl(), N, a);
+}
+
+void exblas::numa_first_touch(Context & ctx, int64_t N, float *a)
+{
+    FirstTouch(ctx.impl(), N, a);
+}
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExContext.hpp
+ *  \brief Provides the implementation of the execution context on CPUs.
+ *         For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXCONTEXT_HPP_
+#define EXCONTEXT_HPP_
+
+#include <vector>
+#include "context.hpp"
+#include "transport.hpp"
+#include "superaccumulator.hpp"
+#include "ExThreadPool.hpp"
+#include "ExNUMA.hpp"
+
+#ifdef EXBLAS_MPI
+    #include <mpi.h>
+#endif
+
+// Inputs with fewer elements are processed by the calling thread alone
+#ifndef EXBLAS_SERIAL_THRESHOLD
+    #define EXBLAS_SERIAL_THRESHOLD 16384
+#endif
+
+// Number of elements per chunk claimed by the threads with dynamic scheduling
+#ifndef EXBLAS_DYNAMIC_CHUNK
+    #define EXBLAS_DYNAMIC_CHUNK 32768
+#endif
+
+/**
+ * \struct exblas::Context::Impl
+ * \ingroup context
+ * \brief Keeps the thread team size and the memory reused from one call to another
+ */
+struct exblas::Context::Impl {
+    static int constexpr linesize = 16; /**< spacing of the arrival counters, in int32_t */
+
+    ExThreadPool & pool; /**< thread pool of the process */
+    std::vector<int> cpus; /**< hardware thread to pin each thread to, empty without pinning */
+    int nthreads; /**< number of threads in the team */
+    std::vector<Superaccumulator> acc; /**< per-thread superaccumulators, allocated at the first parallel call */
+    Superaccumulator result; /**< result of the current call */
+    std::vector<int32_t> arrived; /**< arrival counters of the reduction tree */
+    std::vector<int64_t> scratch; /**< reduction buffer among processes */
+#ifdef EXBLAS_MPI
+    exblas::MpiTransport world; /**< processes of MPI_COMM_WORLD, among which the results are reduced by default */
+    std::vector<char> scattered[2]; /**< local parts of the vectors scattered from the root process */
+#endif
+    bool deferred; /**< whether the caller merges the result among participants itself, leaving it in result */
+    Reduce reduce; /**< processes receiving the result with MPI */
+    exblas::Transport * transport; /**< group merging the results instead of MPI, or null */
+
+    NumaPolicy numa_policy; /**< how the NUMA placement of the input is taken into account */
+    int ngroups; /**< number of NUMA nodes among which the threads are split */
+    int active_groups; /**< number of groups used by the current call, 1 without NUMA */
+    std::vector<int> group_first; /**< first thread of each group, followed by nthreads */
+    std::vector<int> thread_group; /**< group of each thread */
+    std::vector<int> group_node; /**< NUMA node of each group, as an index in ExNumaNodes() */
+    std::vector<int32_t> group_arrived; /**< arrival counters of the reduction tree among groups */
+    std::vector<int64_t> segments; /**< part of the input of each group, followed by its size */
+
+    Schedule schedule; /**< distribution of the input among the threads */
+    int64_t chunk; /**< number of elements per chunk with dynamic scheduling */
+    int64_t step; /**< chunk size of the current call, a multiple of its alignment */
+    std::vector<int64_t> next; /**< next chunk of each group with dynamic scheduling */
+
+    ExHelperThread helper; /**< accumulates the batches of the pipelines while the calling thread merges them */
+
+    /**
+     * Construction
+     * \param nthreads number of threads, as in the construction of exblas::Context
+     * \param placement placement of the threads
+     * \param cpulist list of the CPUs to pin the threads to, or null
+     */
+    Impl(int nthreads, Placement placement, char const * cpulist);
+
+    /**
+     * Returns whether a call on count elements should run on the calling thread alone:
+     * with a single thread, on inputs too small to amortize a parallel region, and
+     * when called from within a parallel region
+     * \param count number of elements
+     */
+    bool Serial(int64_t count) const;
+
+    /**
+     * Resets the per-thread superaccumulators and the arrival counters to zero
+     * \param zero empty superaccumulator that defines the range
+     */
+    void Prepare(Superaccumulator const & zero);
+
+    /**
+     * Splits the input among the groups of threads according to the NUMA policy
+     * \param count number of elements
+     * \param a address of the first element
+     * \param stride distance between elements in bytes
+     * \param align the parts are multiples of align elements
+     */
+    void Partition(int64_t count, void const * a, ptrdiff_t stride, int align);
+
+    /**
+     * Splits the input into equal parts per thread, grouped by NUMA node as done by numa_first_touch
+     * \param count number of elements
+     * \param stride distance between elements in bytes
+     * \param align the parts are multiples of align elements
+     */
+    void PartitionBlocked(int64_t count, ptrdiff_t stride, int align);
+
+    /**
+     * Returns the part [l, r) of the input of a thread, l and r being multiples of align except
+     * for the end of the last thread of a group
+     * \param tid thread ID
+     * \param tnum number of threads in the team
+     * \param align the parts are multiples of align elements
+     */
+    void ThreadRange(unsigned int tid, unsigned int tnum, int align, int64_t & l, int64_t & r) const;
+
+    /**
+     * Resets the chunks of all the groups for dynamic scheduling. To be called after Partition
+     * \param align the chunks are multiples of align elements
+     */
+    void PrepareChunks(int align);
+
+    /**
+     * Claims the next chunk [l, r) of the part of group g, with dynamic scheduling
+     * \param g group
+     * \return false if no chunk of the group is left
+     */
+    bool NextChunk(int g, int64_t & l, int64_t & r);
+
+    /**
+     * Returns the group of a thread
+     * \param tid thread ID
+     * \param tnum number of threads in the team
+     */
+    int ThreadGroup(unsigned int tid, unsigned int tnum) const;
+
+    /**
+     * Pins the calling thread to its hardware thread, or else binds it to the NUMA node of its group.
+     * Does nothing for tid 0, which runs on the calling thread of the application, nor if the backend
+     * does not keep the same thread for a given tid
+     * \param tid thread ID
+     * \param tnum number of threads in the team
+     * \param saved output, CPUs of the thread before binding it
+     * \return true if the thread has been bound
+     */
+    bool Bind(unsigned int tid, unsigned int tnum, ExAffinity & saved);
+};
+
+typedef exblas::Context::Impl ExContext;
+
+/**
+ * \brief Binds the calling thread as its context places it during the lifetime of the object.
+ *  The threads of the pool also run the calls of the other contexts, which may place them differently
+ */
+struct ExBinding {
+    ExBinding(ExContext & ctx, unsigned int tid, unsigned int tnum) : bound(ctx.Bind(tid, tnum, saved)) {}
+    ~ExBinding() {
+        if (bound)
+            saved.Restore();
+    }
+
+    ExAffinity saved;
+    bool bound;
+};
+
+#endif // EXCONTEXT_HPP_
@@ -0,0 +1,298 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+
+#include "ExDOT.hpp"
+#include "blas1.hpp"
+
+
+/*
+ * Returns the input of the dot product of two vectors with the BLAS conventions
+ * for increments and offsets
+ */
+template<typename T>
+static DotInput<T, Vec4d> ExDotInput(int64_t N, T *a, int64_t inca, int64_t offseta, T *b, int64_t incb, int64_t offsetb) {
+    // Reversing both vectors forms the same products
+    if ((inca < 0) && (incb < 0)) {
+        inca = -inca;
+        incb = -incb;
+    }
+    return DotInput<T, Vec4d>(ExFirst(a, N, inca, offseta), inca, ExFirst(b, N, incb, offsetb), incb);
+}
+
+/*
+ * Parallel dot product using our algorithm
+ * If fpe < 3, use superaccumulators only,
+ * Otherwise, use floating-point expansions of size FPE with superaccumulators when needed
+ * early_exit corresponds to the early-exit technique
+ */
+double exdot(int Ng, double *ag, int inca, int offseta, double *bg, int incb, int offsetb, int fpe, bool early_exit) {
+    return exdot(exblas::default_context(), Ng, ag, inca, offseta, bg, incb, offsetb, fpe, early_exit);
+}
+
+double exdot(exblas::Context & context, int Ng, double *ag, int inca, int offseta, double *bg, int incb, int offsetb, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    int N = Ng;
+    double *a = ag, *b = bg;
+#ifdef EXBLAS_MPI
+    // Participants of a transport already hold their own part of the input
+    if (!ctx.transport) {
+        N = ExScatter(ctx.scattered[0], Ng, ag, inca, offseta, a);
+        ExScatter(ctx.scattered[1], Ng, bg, incb, offsetb, b);
+        // The local parts are contiguous, in the order of the products
+        inca = incb = 1;
+        offseta = offsetb = 0;
+    }
+#endif
+    DotInput<double, Vec4d> in = ExDotInput(N, a, inca, offseta, b, incb, offsetb);
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    // with superaccumulators only
+    if (fpe < 3)
+        return ExSUMSuperacc<double>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec4d, double>(ctx, N, in, zero, fpe, early_exit);
+}
+
+/*
+ * Parallel dot product of single-precision vectors using our algorithm
+ * Products of floats are exact in double, so they are accumulated with Vec4d
+ * floating-point expansions and the result is correctly rounded to single precision
+ */
+float exdotf(int Ng, float *ag, int inca, int offseta, float *bg, int incb, int offsetb, int fpe, bool early_exit) {
+    return exdotf(exblas::default_context(), Ng, ag, inca, offseta, bg, incb, offsetb, fpe, early_exit);
+}
+
+float exdotf(exblas::Context & context, int Ng, float *ag, int inca, int offseta, float *bg, int incb, int offsetb, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    int N = Ng;
+    float *a = ag, *b = bg;
+#ifdef EXBLAS_MPI
+    // Participants of a transport already hold their own part of the input
+    if (!ctx.transport) {
+        N = ExScatter(ctx.scattered[0], Ng, ag, inca, offseta, a);
+        ExScatter(ctx.scattered[1], Ng, bg, incb, offsetb, b);
+        // The local parts are contiguous, in the order of the products
+        inca = incb = 1;
+        offseta = offsetb = 0;
+    }
+#endif
+    DotInput<float, Vec4d> in = ExDotInput(N, a, inca, offseta, b, incb, offsetb);
+    static const Superaccumulator zero(e_bits_fdot, f_bits_fdot);
+
+    // with superaccumulators only
+    if (fpe < 3)
+        return ExSUMSuperacc<float>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec4d, float>(ctx, N, in, zero, fpe, early_exit);
+}
+
+/*
+ * Parallel dot product of vectors with 64-bit sizes using our algorithm
+ * Each thread flushes its floating-point expansions every EXBLAS_CHUNK_SIZE elements.
+ * With MPI, each process multiplies its own parts of the vectors, without scattering
+ */
+double exdot_64(int64_t N, double *a, int64_t inca, int64_t offseta, double *b, int64_t incb, int64_t offsetb, int fpe, bool early_exit) {
+    return exdot_64(exblas::default_context(), N, a, inca, offseta, b, incb, offsetb, fpe, early_exit);
+}
+
+double exdot_64(exblas::Context & context, int64_t N, double *a, int64_t inca, int64_t offseta, double *b, int64_t incb, int64_t offsetb, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    DotInput<double, Vec4d> in = ExDotInput(N, a, inca, offseta, b, incb, offsetb);
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    // with superaccumulators only
+    if (fpe < 3)
+        return ExSUMSuperacc<double>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec4d, double>(ctx, N, in, zero, fpe, early_exit);
+}
+
+/*
+ * Parallel dot product of single-precision vectors with 64-bit sizes using our algorithm
+ * Same as exdot_64, with the result correctly rounded to single precision
+ */
+float exdotf_64(int64_t N, float *a, int64_t inca, int64_t offseta, float *b, int64_t incb, int64_t offsetb, int fpe, bool early_exit) {
+    return exdotf_64(exblas::default_context(), N, a, inca, offseta, b, incb, offsetb, fpe, early_exit);
+}
+
+float exdotf_64(exblas::Context & context, int64_t N, float *a, int64_t inca, int64_t offseta, float *b, int64_t incb, int64_t offsetb, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    DotInput<float, Vec4d> in = ExDotInput(N, a, inca, offseta, b, incb, offsetb);
+    static const Superaccumulator zero(e_bits_fdot, f_bits_fdot);
+
+    // with superaccumulators only
+    if (fpe < 3)
+        return ExSUMSuperacc<float>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec4d, float>(ctx, N, in, zero, fpe, early_exit);
+}
+
+// Multiplies and sums the local elements into ctx.result, leaving their merge among participants to the caller
+static void ExLocalDot(ExContext & ctx, int64_t local_n, double *local_a, double *local_b, int fpe, bool early_exit) {
+    DotInput<double, Vec4d> in = ExDotInput(local_n, local_a, 1, 0, local_b, 1, 0);
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    ctx.result = zero;
+    ctx.deferred = true;
+    if (fpe < 3)
+        ExSUMSuperacc<double>(ctx, local_n, in, zero);
+    else
+        ExSUMFPEDispatch<Vec4d, double>(ctx, local_n, in, zero, fpe, early_exit);
+    ctx.deferred = false;
+}
+
+/*
+ * Parallel dot product of vectors distributed alike over the participants of transport using our algorithm
+ * Each participant multiplies its local elements in place; only the superaccumulators travel to participant 0
+ */
+double exdot_dist(int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, int fpe, bool early_exit) {
+    return exdot_dist(exblas::default_context(), local_n, local_a, local_b, transport, fpe, early_exit);
+}
+
+double exdot_dist(exblas::Context & context, int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    ExLocalDot(ctx, local_n, local_a, local_b, fpe, early_exit);
+    ExMerge(ctx.result, transport, ctx.reduce == exblas::ReduceAll, ctx.scratch);
+    return ctx.result.Round();
+}
+
+/*
+ * Non-blocking parallel dot product of distributed vectors using our algorithm
+ * The local superaccumulator is computed before returning; its merge onto all the participants is left in flight
+ */
+exblas::Request exdot_iallreduce(int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, int fpe, bool early_exit) {
+    return exdot_iallreduce(exblas::default_context(), local_n, local_a, local_b, transport, fpe, early_exit);
+}
+
+exblas::Request exdot_iallreduce(exblas::Context & context, int64_t local_n, double *local_a, double *local_b, exblas::Transport & transport, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    ExLocalDot(ctx, local_n, local_a, local_b, fpe, early_exit);
+    return ExIallreduce(ctx.result, transport);
+}
+
+/*
+ * Parallel dot products of several pairs of distributed vectors using our algorithm
+ * Their superaccumulators are merged onto all the participants at once
+ */
+void exdot_dist_batch(int count, int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    exdot_dist_batch(exblas::default_context(), count, local_n, local_a, local_b, transport, fpe, results, early_exit);
+}
+
+void exdot_dist_batch(exblas::Context & context, int count, int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    std::vector<Superaccumulator> accs;
+    for (int k = 0; k != count; ++k) {
+        ExLocalDot(ctx, local_n, local_a[k], local_b[k], fpe, early_exit);
+        accs.push_back(ctx.result);
+    }
+    ExAllreduceBatch(accs, transport, results);
+}
+
+/*
+ * Parallel dot products of steps batches of count pairs of distributed vectors using our algorithm
+ * The threads multiply the vectors of the next batch while the superaccumulators of the current one are merged
+ */
+void exdot_dist_pipeline(int steps, int count, int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    exdot_dist_pipeline(exblas::default_context(), steps, count, local_n, local_a, local_b, transport, fpe, results, early_exit);
+}
+
+void exdot_dist_pipeline(exblas::Context & context, int steps, int count, int64_t local_n, double * const *local_a, double * const *local_b, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    ExPipelineBatches(ctx.helper, steps, count, transport, results, [&](int step, std::vector<Superaccumulator> & accs) {
+        accs.clear();
+        for (int k = 0; k != count; ++k) {
+            ExLocalDot(ctx, local_n, local_a[int64_t(step) * count + k], local_b[int64_t(step) * count + k], fpe, early_exit);
+            accs.push_back(ctx.result);
+        }
+    });
+}
+
+#ifdef EXBLAS_MPI
+/*
+ * Same dot products over the processes of comm, merged by an MpiTransport
+ */
+double exdot_dist(int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, int fpe, bool early_exit) {
+    return exdot_dist(exblas::default_context(), local_n, local_a, local_b, comm, fpe, early_exit);
+}
+
+double exdot_dist(exblas::Context & context, int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, int fpe, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    return exdot_dist(context, local_n, local_a, local_b, transport, fpe, early_exit);
+}
+
+exblas::Request exdot_iallreduce(int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, int fpe, bool early_exit) {
+    return exdot_iallreduce(exblas::default_context(), local_n, local_a, local_b, comm, fpe, early_exit);
+}
+
+exblas::Request exdot_iallreduce(exblas::Context & context, int64_t local_n, double *local_a, double *local_b, MPI_Comm comm, int fpe, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    return exdot_iallreduce(context, local_n, local_a, local_b, transport, fpe, early_exit);
+}
+
+void exdot_dist_batch(int count, int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exdot_dist_batch(exblas::default_context(), count, local_n, local_a, local_b, comm, fpe, results, early_exit);
+}
+
+void exdot_dist_batch(exblas::Context & context, int count, int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    exdot_dist_batch(context, count, local_n, local_a, local_b, transport, fpe, results, early_exit);
+}
+
+void exdot_dist_pipeline(int steps, int count, int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exdot_dist_pipeline(exblas::default_context(), steps, count, local_n, local_a, local_b, comm, fpe, results, early_exit);
+}
+
+void exdot_dist_pipeline(exblas::Context & context, int steps, int count, int64_t local_n, double * const *local_a, double * const *local_b, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    exdot_dist_pipeline(context, steps, count, local_n, local_a, local_b, transport, fpe, results, early_exit);
+}
+#endif
+
+/*
+ * Asynchronous parallel dot product using our algorithm
+ * The vectors are split into chunks queued on the thread pool, so that
+ * several calls in flight share the threads. The result is the same as exdot's
+ */
+std::future<double> exdot_async(int N, double *a, int inca, int offseta, double *b, int incb, int offsetb, int fpe, bool early_exit) {
+    fpe = ExClampFPE(fpe);
+
+    DotInput<double, Vec4d> in = ExDotInput(N, a, inca, offseta, b, incb, offsetb);
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    // with superaccumulators only
+    if (fpe < 3)
+        return ExSUMSuperaccAsync<double>(N, in, zero);
+
+    return ExSUMFPEAsyncDispatch<Vec4d, double>(N, in, zero, fpe, early_exit);
+}
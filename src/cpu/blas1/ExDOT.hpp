@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExDOT.hpp
+ *  \brief Provides a set of dot product routines
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXDOT_HPP_
+#define EXDOT_HPP_
+
+#include <cmath>
+#include "ExSUM.Async.hpp"
+#include "ExLoad.hpp"
+
+
+/**
+ * \ingroup ExDOT
+ * \brief Computes the product of two vectors and its rounding error exactly: x * y = p + e
+ *
+ * \param x vector
+ * \param y vector
+ * \param e rounding error of the product
+ * \return Rounded product
+ */
+inline static Vec4d TwoProductFMA(Vec4d x, Vec4d y, Vec4d & e)
+{
+    Vec4d p = x * y;
+#if INSTRSET > 7                       // AVX2 and later
+    e = fms(x, y, p);
+#else
+    // Dekker's product with Veltkamp splitting
+    Vec4d const splitter(134217729.);  // 2^27 + 1
+    Vec4d t = splitter * x;
+    Vec4d xh = t - (t - x);
+    Vec4d xl = x - xh;
+    t = splitter * y;
+    Vec4d yh = t - (t - y);
+    Vec4d yl = y - yh;
+    e = ((xh * yh - p) + xh * yl + xl * yh) + xl * yl;
+#endif
+    return p;
+}
+
+/**
+ * \class DotInput
+ * \ingroup ExDOT
+ * \brief Loads elements of type T from two vectors with any increments and alignment,
+ *  forms their products exactly, and feeds them to floating-point expansions of vectors V
+ *  or to a superaccumulator. For internal use
+ */
+template<typename T, typename V> struct DotInput;
+
+/**
+ * \ingroup ExDOT
+ * \brief Double-precision products split into their rounded value and error with TwoProductFMA
+ */
+template<> struct DotInput<double, Vec4d> {
+    static int constexpr block = 4; /**< number of elements consumed per step */
+    double const * a; /**< first element of the first real vector */
+    int64_t inca; /**< increment between elements of a */
+    double const * b; /**< first element of the second real vector */
+    int64_t incb; /**< increment between elements of b */
+
+    DotInput(double const * a, int64_t inca, double const * b, int64_t incb) : a(a), inca(inca), b(b), incb(incb) {}
+
+    template<typename CACHE>
+    void Accumulate(CACHE & cache, int64_t i) const {
+        Vec4d e;
+        Vec4d p = TwoProductFMA(ExLoad(a + i * inca, inca), ExLoad(b + i * incb, incb), e);
+        cache.Accumulate(p, e);
+    }
+    template<typename CACHE>
+    void AccumulateTail(CACHE & cache, int64_t i, int n) const {
+        Vec4d e;
+        Vec4d p = TwoProductFMA(ExLoadPartial(a + i * inca, inca, n), ExLoadPartial(b + i * incb, incb, n), e);
+        cache.Accumulate(p, e);
+    }
+    void Accumulate(Superaccumulator & acc, int64_t i) const {
+        double x = a[i * inca], y = b[i * incb];
+        double p = x * y;
+        acc.Accumulate(p);
+        acc.Accumulate(std::fma(x, y, -p));
+    }
+    void Prefetch(int64_t i, int dist) const {
+        _mm_prefetch((char const*)(a + i * inca) + dist, _MM_HINT_T0);
+        _mm_prefetch((char const*)(b + i * incb) + dist, _MM_HINT_T0);
+    }
+    ptrdiff_t Stride() const { return inca * sizeof(*a); }
+};
+
+/**
+ * \ingroup ExDOT
+ * \brief Single-precision elements widened to double, where their products are exact
+ */
+template<> struct DotInput<float, Vec4d> {
+    static int constexpr block = 8; /**< number of elements consumed per step */
+    float const * a; /**< first element of the first real vector */
+    int64_t inca; /**< increment between elements of a */
+    float const * b; /**< first element of the second real vector */
+    int64_t incb; /**< increment between elements of b */
+
+    DotInput(float const * a, int64_t inca, float const * b, int64_t incb) : a(a), inca(inca), b(b), incb(incb) {}
+
+    template<typename CACHE>
+    void Accumulate(CACHE & cache, int64_t i) const {
+        Vec8f x = ExLoad(a + i * inca, inca);
+        Vec8f y = ExLoad(b + i * incb, incb);
+        cache.Accumulate(extend_low(x) * extend_low(y), extend_high(x) * extend_high(y));
+    }
+    template<typename CACHE>
+    void AccumulateTail(CACHE & cache, int64_t i, int n) const {
+        Vec8f x = ExLoadPartial(a + i * inca, inca, n);
+        Vec8f y = ExLoadPartial(b + i * incb, incb, n);
+        cache.Accumulate(extend_low(x) * extend_low(y), extend_high(x) * extend_high(y));
+    }
+    void Accumulate(Superaccumulator & acc, int64_t i) const {
+        acc.Accumulate(double(a[i * inca]) * double(b[i * incb]));
+    }
+    void Prefetch(int64_t i, int dist) const {
+        _mm_prefetch((char const*)(a + i * inca) + dist, _MM_HINT_T0);
+        _mm_prefetch((char const*)(b + i * incb) + dist, _MM_HINT_T0);
+    }
+    ptrdiff_t Stride() const { return inca * sizeof(*a); }
+};
+
+#endif // EXDOT_HPP_
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExLoad.hpp
+ *  \brief Provides vector loads of strided and unaligned elements, with masked
+ *         loads for the tails of vectors. For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXLOAD_HPP_
+#define EXLOAD_HPP_
+
+#include <stdint.h>
+#include "vectorclass.h"
+
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the address of the first element of a vector of N elements with
+ *     increment inc stored from a + offset. As in BLAS, with a negative increment
+ *     the elements are taken from the end
+ *
+ * \param a array
+ * \param N number of elements
+ * \param inc increment between elements
+ * \param offset position of the vector from the start of a
+ */
+template<typename T>
+inline static T * ExFirst(T * a, int64_t N, int64_t inc, int64_t offset)
+{
+    return a + offset + ((inc < 0) ? (N - 1) * -inc : 0);
+}
+
+// Masks of the first n lanes are read from these tables at offset 4 - n (resp. 8 - n)
+static int64_t const ExMask64[8] __attribute__((aligned(64))) = {-1, -1, -1, -1, 0, 0, 0, 0};
+static int32_t const ExMask32[16] __attribute__((aligned(64))) = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+/**
+ * \ingroup ExSUM
+ * \brief Loads the 4 elements p[0], p[inc], p[2 inc], p[3 inc], without alignment requirement
+ *
+ * \param p first element
+ * \param inc increment between elements
+ */
+inline static Vec4d ExLoad(double const * p, int64_t inc)
+{
+    if (inc == 1)
+        return Vec4d().load(p);
+#if INSTRSET > 7                       // AVX2 and later
+    return _mm256_i64gather_pd(p, _mm256_set_epi64x(3 * inc, 2 * inc, inc, 0), 8);
+#else
+    return Vec4d(p[0], p[inc], p[2 * inc], p[3 * inc]);
+#endif
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Loads the 8 elements p[0], p[inc], ..., p[7 inc], without alignment requirement
+ *
+ * \param p first element
+ * \param inc increment between elements
+ */
+inline static Vec8f ExLoad(float const * p, int64_t inc)
+{
+    if (inc == 1)
+        return Vec8f().load(p);
+#if INSTRSET > 7                       // AVX2 and later
+    __m256i idx = _mm256_set_epi64x(3 * inc, 2 * inc, inc, 0);
+    return Vec8f(_mm256_i64gather_ps(p, idx, 4), _mm256_i64gather_ps(p + 4 * inc, idx, 4));
+#else
+    return Vec8f(p[0], p[inc], p[2 * inc], p[3 * inc], p[4 * inc], p[5 * inc], p[6 * inc], p[7 * inc]);
+#endif
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as ExLoad, but only the first n elements are read, the other lanes being zero
+ *
+ * \param p first element
+ * \param inc increment between elements
+ * \param n number of elements to read, in [0, 4]
+ */
+inline static Vec4d ExLoadPartial(double const * p, int64_t inc, int n)
+{
+    __m256i mask = _mm256_loadu_si256((__m256i const *)(ExMask64 + 4 - n));
+    if (inc == 1)
+        return _mm256_maskload_pd(p, mask);
+#if INSTRSET > 7                       // AVX2 and later
+    return _mm256_mask_i64gather_pd(_mm256_setzero_pd(), p, _mm256_set_epi64x(3 * inc, 2 * inc, inc, 0),
+        _mm256_castsi256_pd(mask), 8);
+#else
+    double x[4] = {0., 0., 0., 0.};
+    for (int k = 0; k != n; ++k)
+        x[k] = p[k * inc];
+    return Vec4d().load(x);
+#endif
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Same as ExLoad, but only the first n elements are read, the other lanes being zero
+ *
+ * \param p first element
+ * \param inc increment between elements
+ * \param n number of elements to read, in [0, 8]
+ */
+inline static Vec8f ExLoadPartial(float const * p, int64_t inc, int n)
+{
+    __m256i mask = _mm256_loadu_si256((__m256i const *)(ExMask32 + 8 - n));
+    if (inc == 1)
+        return _mm256_maskload_ps(p, mask);
+#if INSTRSET > 7                       // AVX2 and later
+    __m256i idx = _mm256_set_epi64x(3 * inc, 2 * inc, inc, 0);
+    __m128 lo = _mm256_mask_i64gather_ps(_mm_setzero_ps(), p, idx,
+        _mm_castsi128_ps(_mm256_castsi256_si128(mask)), 4);
+    if (n <= 4)
+        return Vec8f(lo, _mm_setzero_ps());
+    __m128 hi = _mm256_mask_i64gather_ps(_mm_setzero_ps(), p + 4 * inc, idx,
+        _mm_castsi128_ps(_mm256_extractf128_si256(mask, 1)), 4);
+    return Vec8f(lo, hi);
+#else
+    float x[8] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+    for (int k = 0; k != n; ++k)
+        x[k] = p[k * inc];
+    return Vec8f().load(x);
+#endif
+}
+
+#endif // EXLOAD_HPP_
@@ -0,0 +1,202 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "ExNUMA.hpp"
+
+
+// Parses a cpulist such as "0-3,8-11"
+static std::vector<int> ParseCpuList(FILE * f)
+{
+    std::vector<int> cpus;
+    int first, last;
+    while (fscanf(f, "%d", &first) == 1) {
+        last = first;
+        int c = fgetc(f);
+        if (c == '-') {
+            if (fscanf(f, "%d", &last) != 1)
+                break;
+            c = fgetc(f);
+        }
+        for (int i = first; i <= last; i++)
+            cpus.push_back(i);
+        if (c != ',')
+            break;
+    }
+    return cpus;
+}
+
+// Node ids, in the same order as ExNumaNodes()
+static std::vector<int> & NodeIds()
+{
+    static std::vector<int> ids;
+    return ids;
+}
+
+static std::vector<std::vector<int> > DetectNodes()
+{
+    std::vector<std::vector<int> > nodes;
+    char path[64];
+    for (int id = 0; id < 1024; id++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+        FILE * f = fopen(path, "r");
+        if (!f)
+            continue;
+        std::vector<int> cpus = ParseCpuList(f);
+        fclose(f);
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+            NodeIds().push_back(id);
+        }
+    }
+    if (nodes.empty()) {
+        // No NUMA information: a single node with all the CPUs
+        nodes.push_back(std::vector<int>());
+        NodeIds().push_back(-1);
+    }
+    return nodes;
+}
+
+std::vector<std::vector<int> > const & ExNumaNodes()
+{
+    static std::vector<std::vector<int> > nodes = DetectNodes();
+    return nodes;
+}
+
+bool ExPageNodes(int count, void const * const * pages, int * nodes)
+{
+    ExNumaNodes();
+#ifdef SYS_move_pages
+    std::vector<void *> p(count);
+    for (int i = 0; i != count; i++)
+        p[i] = (void *)(uintptr_t(pages[i]) & ~uintptr_t(sysconf(_SC_PAGESIZE) - 1));
+    std::vector<int> status(count, -1);
+    // With no target nodes, move_pages only reports where the pages reside
+    if (syscall(SYS_move_pages, 0, (unsigned long)count, &p[0], (void *)0, &status[0], 0) != 0)
+        return false;
+    std::vector<int> const & ids = NodeIds();
+    for (int i = 0; i != count; i++) {
+        nodes[i] = -1;
+        for (size_t n = 0; n != ids.size(); n++)
+            if (ids[n] == status[i])
+                nodes[i] = n;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ExBindToNode(int node)
+{
+    std::vector<int> const & cpus = ExNumaNodes()[node];
+    if (cpus.empty())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i != cpus.size(); i++)
+        CPU_SET(cpus[i], &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        fprintf(stderr, "Cannot bind thread to NUMA node %d\n", node);
+}
+
+int ExCpuNode(int cpu)
+{
+    std::vector<std::vector<int> > const & nodes = ExNumaNodes();
+    for (size_t n = 0; n != nodes.size(); n++)
+        if (std::find(nodes[n].begin(), nodes[n].end(), cpu) != nodes[n].end())
+            return n;
+    return 0;
+}
+
+// Returns the SMT siblings of a CPU, including itself
+static std::vector<int> Siblings(int cpu)
+{
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    FILE * f = fopen(path, "r");
+    if (!f)
+        return std::vector<int>(1, cpu);
+    std::vector<int> cpus = ParseCpuList(f);
+    fclose(f);
+    return cpus.empty() ? std::vector<int>(1, cpu) : cpus;
+}
+
+std::vector<std::vector<int> > ExCpuCores(char const * cpulist)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        for (int cpu = 0; cpu != int(sysconf(_SC_NPROCESSORS_ONLN)) && cpu != CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, &allowed);
+    if (cpulist) {
+        std::vector<int> cpus;
+        FILE * f = fmemopen((void *)cpulist, strlen(cpulist), "r");
+        if (f) {
+            cpus = ParseCpuList(f);
+            fclose(f);
+        }
+        if (cpus.empty())
+            fprintf(stderr, "Cannot parse the list of CPUs %s\n", cpulist);
+        cpu_set_t listed;
+        CPU_ZERO(&listed);
+        for (size_t i = 0; i != cpus.size(); i++)
+            if ((cpus[i] >= 0) && (cpus[i] < CPU_SETSIZE))
+                CPU_SET(cpus[i], &listed);
+        if (!cpus.empty())
+            CPU_AND(&allowed, &allowed, &listed);
+    }
+
+    // Cores are keyed by their first hardware thread
+    std::vector<std::vector<int> > cores;
+    std::vector<int> first;
+    for (int cpu = 0; cpu != CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        int key = Siblings(cpu)[0];
+        size_t c = std::find(first.begin(), first.end(), key) - first.begin();
+        if (c == first.size()) {
+            first.push_back(key);
+            cores.push_back(std::vector<int>());
+        }
+        cores[c].push_back(cpu);
+    }
+    std::stable_sort(cores.begin(), cores.end(), [](std::vector<int> const & x, std::vector<int> const & y) {
+        return ExCpuNode(x[0]) < ExCpuNode(y[0]);
+    });
+    return cores;
+}
+
+void ExBindToCpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        fprintf(stderr, "Cannot bind thread to CPU %d\n", cpu);
+}
+
+void ExAffinity::Save()
+{
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu != int(sysconf(_SC_NPROCESSORS_ONLN)) && cpu != CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, &set);
+    }
+}
+
+void ExAffinity::Restore() const
+{
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        fprintf(stderr, "Cannot restore the CPUs of thread\n");
+}
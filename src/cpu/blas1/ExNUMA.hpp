@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExNUMA.hpp
+ *  \brief Provides NUMA and core topology detection, page placement queries and thread binding.
+ *         For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXNUMA_HPP_
+#define EXNUMA_HPP_
+
+#include <vector>
+#include <sched.h>
+
+/**
+ * \ingroup context
+ * \brief Returns the CPUs of each NUMA node with memory, in the order of node ids.
+ *     Read once from /sys/devices/system/node; a single node is reported when it is unavailable
+ */
+std::vector<std::vector<int> > const & ExNumaNodes();
+
+/**
+ * \ingroup context
+ * \brief Finds the NUMA node on which each of the given pages resides
+ *
+ * \param count number of pages
+ * \param pages addresses within the pages
+ * \param nodes output, index in ExNumaNodes() of the node of each page, or -1 if unknown
+ * \return true if the placement could be queried
+ */
+bool ExPageNodes(int count, void const * const * pages, int * nodes);
+
+/**
+ * \ingroup context
+ * \brief Binds the calling thread to the CPUs of a NUMA node
+ *
+ * \param node index in ExNumaNodes()
+ */
+void ExBindToNode(int node);
+
+/**
+ * \ingroup context
+ * \brief Returns the index in ExNumaNodes() of the node of a CPU, 0 when unknown
+ *
+ * \param cpu CPU id
+ */
+int ExCpuNode(int cpu);
+
+/**
+ * \ingroup context
+ * \brief Returns the physical cores on which the calling thread may run, each one as the list of
+ *     its hardware threads (SMT siblings), in the order of the NUMA nodes then of the CPU ids
+ *
+ * \param cpulist if not null, list of the CPUs to use, such as "0-7,16-23",
+ *     in addition to the affinity mask of the calling thread
+ */
+std::vector<std::vector<int> > ExCpuCores(char const * cpulist);
+
+/**
+ * \ingroup context
+ * \brief Binds the calling thread to a CPU
+ *
+ * \param cpu CPU id
+ */
+void ExBindToCpu(int cpu);
+
+/**
+ * \ingroup context
+ * \brief CPUs on which a thread may run, saved before binding it so that they can be restored
+ */
+struct ExAffinity {
+    /**
+     * Saves the CPUs of the calling thread
+     */
+    void Save();
+
+    /**
+     * Lets the calling thread run on the saved CPUs again
+     */
+    void Restore() const;
+
+    cpu_set_t set;
+};
+
+#endif // EXNUMA_HPP_
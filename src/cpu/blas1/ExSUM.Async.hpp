@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExSUM.Async.hpp
+ *  \brief Provides the asynchronous skeleton shared by the summation-based routines:
+ *         the input is split into fixed-size chunks, each one a task of the thread pool.
+ *         For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXSUM_ASYNC_HPP_
+#define EXSUM_ASYNC_HPP_
+
+#include <future>
+#include <memory>
+#include "ExSUM.Parallel.hpp"
+
+// Number of elements per task of the asynchronous routines
+#ifndef EXBLAS_ASYNC_CHUNK
+    #define EXBLAS_ASYNC_CHUNK 65536
+#endif
+
+
+/**
+ * \struct ExAsyncState
+ * \ingroup ExSUM
+ * \brief State shared by the tasks of an asynchronous call, freed with the last of them
+ */
+template<typename R>
+struct ExAsyncState {
+    static int constexpr linesize = ExContext::linesize; /**< spacing of the arrival counters, in int32_t */
+
+    std::vector<Superaccumulator> acc; /**< per-chunk superaccumulators */
+    std::vector<int32_t> arrived; /**< arrival counters of the reduction tree */
+    std::promise<R> result; /**< receives the rounded result */
+};
+
+/**
+ * \ingroup ExSUM
+ * \brief Splits [0, count) into chunks of EXBLAS_ASYNC_CHUNK elements and enqueues one task per chunk.
+ *     Each task accumulates its chunk into its own superaccumulator, then the chunks are merged
+ *     along the same wait-free tree as threads, the last task rounding the result. The result
+ *     is not merged among processes, as the tasks run outside the collective calls of the caller
+ *
+ * \param count number of elements
+ * \param align the chunks are multiples of align elements
+ * \param zero empty superaccumulator covering the range of the elements
+ * \param accumulate function accumulating the elements [l, r) into a normalized superaccumulator
+ * \return Future receiving the reproducible and accurate result rounded to R
+ */
+template<typename R, typename ACCUMULATE>
+std::future<R> ExAsync(int64_t count, int align, Superaccumulator const & zero, ACCUMULATE accumulate)
+{
+    int64_t chunk = (EXBLAS_ASYNC_CHUNK + align - 1) / align * align;
+    int nchunks = std::max<int64_t>((count + chunk - 1) / chunk, 1);
+
+    std::shared_ptr<ExAsyncState<R> > state = std::make_shared<ExAsyncState<R> >();
+    state->acc.assign(nchunks, zero);
+    state->arrived.assign(nchunks * ExAsyncState<R>::linesize, 0);
+    std::future<R> result = state->result.get_future();
+
+    ExThreadPool & pool = ExPool();
+    for (int c = 0; c != nchunks; ++c) {
+        pool.Enqueue([state, c, nchunks, chunk, count, accumulate] {
+            std::vector<Superaccumulator> & acc = state->acc;
+            accumulate(c * chunk, std::min(count, (c + 1) * chunk), acc[c]);
+            if (Reduction(c, nchunks, &state->arrived[0],
+                [&](unsigned int i) -> Superaccumulator & { return acc[i]; }, ExAsyncState<R>::linesize))
+                state->result.set_value(ExRound<R>(acc[0]));
+        });
+    }
+    return result;
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Our alg with superaccumulators only, asynchronously
+ *
+ * \param N number of elements
+ * \param in elements to sum
+ * \param zero empty superaccumulator covering the range of the elements
+ * \return Future receiving the reproducible and accurate sum rounded to R
+ */
+template<typename R, typename INPUT>
+std::future<R> ExSUMSuperaccAsync(int64_t N, INPUT const & in, Superaccumulator const & zero) {
+    return ExAsync<R>(N, 1, zero, [in](int64_t l, int64_t r, Superaccumulator & acc) {
+        for(int64_t k = l; k < r; ++k) {
+            in.Accumulate(acc, k);
+        }
+        acc.Normalize();
+    });
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Our alg with floating-point expansions of type CACHE and superaccumulators when needed,
+ *     asynchronously. The elements are the same as the ones of ExSUMFPE
+ *
+ * \param N number of elements
+ * \param in elements to sum
+ * \param zero empty superaccumulator covering the range of the elements
+ * \param prefetch software prefetching distance in bytes; 0 disables prefetching
+ * \return Future receiving the reproducible and accurate sum rounded to R
+ */
+template<typename CACHE, int NBFPE, typename R, typename INPUT>
+std::future<R> ExSUMFPEAsync(int64_t N, INPUT const & in, Superaccumulator const & zero, int prefetch) {
+    return ExAsync<R>(N, INPUT::block, zero, [in, prefetch](int64_t l, int64_t r, Superaccumulator & acc) {
+        ExAccumulateFPE<CACHE, NBFPE>(in, l, r, prefetch, acc);
+    });
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Selects the floating-point expansion of vectors V matching fpe and early_exit, asynchronously
+ *
+ * \param N number of elements
+ * \param in elements to sum
+ * \param zero empty superaccumulator covering the range of the elements
+ * \param fpe size of floating-point expansion, in the interval [2, 8]
+ * \param early_exit specifies the optimization technique
+ * \return Future receiving the reproducible and accurate sum rounded to R
+ */
+template<typename V, typename R, typename INPUT>
+std::future<R> ExSUMFPEAsyncDispatch(int64_t N, INPUT const & in, Superaccumulator const & zero, int fpe, bool early_exit) {
+    if (early_exit) {
+        if (fpe <= 4)
+            return ExSUMFPEAsync<FPExpansionVect<V, 4, FPExpansionTraits<true> >, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        if (fpe <= 6)
+            return ExSUMFPEAsync<FPExpansionVect<V, 6, FPExpansionTraits<true> >, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        if (fpe <= 8)
+            return ExSUMFPEAsync<FPExpansionVect<V, 8, FPExpansionTraits<true> >, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+    } else switch (fpe) {
+        case 2: return ExSUMFPEAsync<FPExpansionVect<V, 2>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 3: return ExSUMFPEAsync<FPExpansionVect<V, 3>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 4: return ExSUMFPEAsync<FPExpansionVect<V, 4>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 5: return ExSUMFPEAsync<FPExpansionVect<V, 5>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 6: return ExSUMFPEAsync<FPExpansionVect<V, 6>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 7: return ExSUMFPEAsync<FPExpansionVect<V, 7>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 8: return ExSUMFPEAsync<FPExpansionVect<V, 8>, EXBLAS_FPE_INTERLEAVE, R>(N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+    }
+
+    // Same result as the blocking routines
+    std::promise<R> none;
+    none.set_value(0.0);
+    return none.get_future();
+}
+
+#endif // EXSUM_ASYNC_HPP_
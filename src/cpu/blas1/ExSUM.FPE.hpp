@@ -15,6 +15,9 @@
 #ifndef EXSUM_FPE_HPP_
 #define EXSUM_FPE_HPP_
 
+#include <new>
+#include <type_traits>
+
 /**
  * \struct FPExpansionTraits
  * \ingroup ExSUM
@@ -48,6 +51,12 @@ struct FPExpansionVect
      */
     FPExpansionVect(Superaccumulator & sa);
 
+    /**
+     * Constructor for expansions whose lanes hold independent sums
+     * \param lanes superaccumulator of each lane, receiving the flushes of its sum
+     */
+    FPExpansionVect(Superaccumulator * const * lanes);
+
     /** 
      * This function accumulates value x to the floating-point expansion
      * \param x input value
@@ -79,15 +88,70 @@ private:
     static T twosum(T a, T b, T & s);
 
     Superaccumulator & superacc;
+    Superaccumulator * const * lanes;
 
     // Most significant digits first!
     T a[N] __attribute__((aligned(32)));
     T victim;
 };
 
+/**
+ * \struct FPExpansionPack
+ * \ingroup ExSUM
+ * \brief This struct groups K independent floating-point expansions that flush
+ *  into the same superaccumulator. Feeding them in a round-robin fashion breaks
+ *  the serial chain of twosums of a single expansion
+ */
+template<typename CACHE, int K>
+struct FPExpansionPack
+{
+    /**
+     * Constructor
+     * \param sa superaccumulator shared by all the expansions of the pack
+     */
+    FPExpansionPack(Superaccumulator & sa) {
+        for(int k = 0; k != K; ++k)
+            new(&storage[k]) CACHE(sa);
+    }
+
+    ~FPExpansionPack() {
+        for(int k = 0; k != K; ++k)
+            (*this)[k].~CACHE();
+    }
+
+    /**
+     * Returns the k-th floating-point expansion of the pack
+     * \param k index of the expansion
+     */
+    CACHE & operator[](int k) {
+        return *reinterpret_cast<CACHE *>(&storage[k]);
+    }
+
+    /**
+     * This function flushes all the expansions to the superaccumulator.
+     * As superaccumulation is exact, the result does not depend on K
+     */
+    void Flush() {
+        for(int k = 0; k != K; ++k)
+            (*this)[k].Flush();
+    }
+private:
+    typename std::aligned_storage<sizeof(CACHE), alignof(CACHE)>::type storage[K];
+};
+
 template<typename T, int N, typename TRAITS>
 FPExpansionVect<T,N,TRAITS>::FPExpansionVect(Superaccumulator & sa) :
     superacc(sa),
+    lanes(0),
+    victim(0)
+{
+    std::fill(a, a + N, 0);
+}
+
+template<typename T, int N, typename TRAITS>
+FPExpansionVect<T,N,TRAITS>::FPExpansionVect(Superaccumulator * const * lanes) :
+    superacc(*lanes[0]),
+    lanes(lanes),
     victim(0)
 {
     std::fill(a, a + N, 0);
@@ -103,6 +167,17 @@ inline static T Knuth2Sum(T a, T b, T & s)
     return r;
 }
 
+// any(m && x != +0)
+inline static bool horizontal_or_and(Vec4db const & m, Vec4d const & x)
+{
+    return !_mm256_testz_si256(_mm256_castpd_si256(m), _mm256_castpd_si256(x));
+}
+
+inline static bool horizontal_or_and(Vec8fb const & m, Vec8f const & x)
+{
+    return !_mm256_testz_si256(_mm256_castps_si256(m), _mm256_castps_si256(x));
+}
+
 // Vector impl with test for fast path
 template<typename T>
 inline static T BiasedSIMD2Sum(T a, T b, T & s)
@@ -111,7 +186,7 @@ inline static T BiasedSIMD2Sum(T a, T b, T & s)
     auto doswap = abs(b) > abs(a);
     //if(unlikely(!_mm256_testz_pd(doswap, doswap)))
     //asm("nop");
-    if(/*unlikely*/(!_mm256_testz_si256(_mm256_castpd_si256(doswap), _mm256_castpd_si256(b))))  // any(doswap && b != +0)
+    if(/*unlikely*/(horizontal_or_and(doswap, b)))  // any(doswap && b != +0)
     {
         // Slow path
         T a2 = select(doswap, b, a);
@@ -124,16 +199,26 @@ inline static T BiasedSIMD2Sum(T a, T b, T & s)
 }
 
 #if INSTRSET > 7                       // AVX2 and later
-Vec4d fma(Vec4d a, Vec4d b, Vec4d c)
+inline static Vec4d fma(Vec4d a, Vec4d b, Vec4d c)
 {
     return Vec4d(_mm256_fmadd_pd(a, b, c));
 }
 
-Vec4d fms(Vec4d a, Vec4d b, Vec4d c)
+inline static Vec4d fms(Vec4d a, Vec4d b, Vec4d c)
 {
     return Vec4d(_mm256_fmsub_pd(a, b, c));
 }
 
+inline static Vec8f fma(Vec8f a, Vec8f b, Vec8f c)
+{
+    return Vec8f(_mm256_fmadd_ps(a, b, c));
+}
+
+inline static Vec8f fms(Vec8f a, Vec8f b, Vec8f c)
+{
+    return Vec8f(_mm256_fmsub_ps(a, b, c));
+}
+
 
 // Knuth 2Sum.
 template<typename T>
@@ -169,6 +254,10 @@ static inline bool sign_horizontal_or (Vec4db const & a) {
     return !_mm256_testz_pd(a,a);
 }
 
+static inline bool sign_horizontal_or (Vec8fb const & a) {
+    return !_mm256_testz_ps(a,a);
+}
+
 // Input:
 // a3 a2 a1 a0
 // b3 b2 b1 b0
@@ -214,6 +303,20 @@ inline static void horizontal_twosum(Vec4d & r, Vec4d & s)
     r = Knuth2Sum(r, s, s);
 }
 
+// Same as above for 8 lanes: exchange odd lanes, then pairs, then halves
+inline static void horizontal_twosum(Vec8f & r, Vec8f & s)
+{
+    Vec8f r2 = blend8f<9,1,11,3,13,5,15,7>(r, s);
+    Vec8f s2 = blend8f<8,0,10,2,12,4,14,6>(r, s);
+    r = Knuth2Sum(r2, s2, s);
+    r2 = blend8f<10,11,2,3,14,15,6,7>(r, s);
+    s2 = blend8f<8,9,0,1,12,13,4,5>(r, s);
+    r = Knuth2Sum(r2, s2, s);
+    r2 = blend8f<12,13,14,15,4,5,6,7>(r, s);
+    s2 = blend8f<8,9,10,11,0,1,2,3>(r, s);
+    r = Knuth2Sum(r2, s2, s);
+}
+
 template<typename T, int N, typename TRAITS>
 T FPExpansionVect<T,N,TRAITS>::twosum(T a, T b, T & s)
 {
@@ -230,13 +333,14 @@ T FPExpansionVect<T,N,TRAITS>::twosum(T a, T b, T & s)
 #endif
 }
 
-inline static void swap_if_nonzero(Vec4d & a, Vec4d & b)
+template<typename T>
+inline static void swap_if_nonzero(T & a, T & b)
 {
     // if(a_i != 0) { a'_i = b_i; b'_i = a_i; }
     // else {         a'_i = 0;   b'_i = b_i; }
-    Vec4db swapmask = (a != 0);
-    Vec4d b2 = select(swapmask, a, b);
-    a = b & Vec4d(swapmask);
+    typename VectorTraits<T>::mask swapmask = (a != 0);
+    T b2 = select(swapmask, a, b);
+    a = b & T(swapmask);
     b = b2;
 }
 
@@ -264,16 +368,17 @@ void FPExpansionVect<T,N,TRAITS>::Insert(T & x)
         // a[N-2] <= a[N-1]
         // a[N-1] <= x
         //T xb = a[0];
-        T xb = T().load_a((double*)&a[0]);
+        typedef typename VectorTraits<T>::scalar S;
+        T xb = T().load_a((S*)&a[0]);
         for(int i = 0; i != N-1; ++i)
         {
             //a[i] = a[i+1];
             T v;
-            v.load_a((double*)&a[i+1]);
-            v.store_a((double*)&a[i]);
+            v.load_a((S*)&a[i+1]);
+            v.store_a((S*)&a[i]);
         }
         //a[N-1] = x;
-        x.store_a((double*)&a[N-1]);
+        x.store_a((S*)&a[N-1]);
         x = xb;
     }
     else {
@@ -313,29 +418,30 @@ void FPExpansionVect<T,N,TRAITS>::Insert(T & x1, T & x2)
 
 
 
-template<typename T, int N, typename TRAITS> UNROLL_ATTRIBUTE INLINE_ATTRIBUTE
+template<typename T, int N, typename TRAITS> UNROLL_ATTRIBUTE
 void FPExpansionVect<T,N,TRAITS>::Accumulate(T x1, T x2)
 {
+    typedef typename VectorTraits<T>::mask M;
     if(TRAITS::CheckRangeFirst) {
         auto p = abs(x1) < abs(a[N-1]);
         if(sign_horizontal_or(p)) {
             FlushVector(x1 & T(p));
-            x1 = T(andnot(Vec4db(x1), p));
+            x1 = T(andnot(M(x1), p));
         }
         p = abs(x2) < abs(a[N-1]);
         if(sign_horizontal_or(p)) {
             FlushVector(x2 & T(p));
-            x2 = T(andnot(Vec4db(x2), p));
+            x2 = T(andnot(M(x2), p));
         }
     }
     
     T s1, s2;
     for(unsigned int i = 0; i != N; ++i) {
-        T ai = Vec4d().load_a((double*)(a+i));
+        T ai = T().load_a((typename VectorTraits<T>::scalar*)(a+i));
         //T ai = a[i];
         ai = twosum(ai, x1, s1);
         ai = twosum(ai, x2, s2);
-        ai.store_a((double*)(a+i));
+        ai.store_a((typename VectorTraits<T>::scalar*)(a+i));
         //a[i] = ai;
         x1 = s1;
         x2 = s2;
@@ -406,13 +512,12 @@ template<typename T, int N, typename TRAITS> inline
 void FPExpansionVect<T,N,TRAITS>::FlushVector(T x) const
 {
     // TODO: update status, handle Inf/Overflow/NaN cases
-    // TODO: make it work for other values of 4
-    double v[4];
+    typename VectorTraits<T>::scalar v[VectorTraits<T>::lanes];
     x.store(v);
     
     _mm256_zeroupper();
-    for(unsigned int j = 0; j != 4; ++j) {
-        superacc.Accumulate(v[j]);
+    for(unsigned int j = 0; j != VectorTraits<T>::lanes; ++j) {
+        (lanes ? *lanes[j] : superacc).Accumulate(double(v[j]));
     }
 }
 
@@ -429,12 +534,12 @@ void FPExpansionVect<T,N,TRAITS>::Dump() const
 template<typename T, int N, typename TRAITS>
 void FPExpansionVect<T,N,TRAITS>::DumpVector(T x) const
 {
-    double v[4] __attribute__((aligned(32)));
+    typename VectorTraits<T>::scalar v[VectorTraits<T>::lanes] __attribute__((aligned(32)));
     x.store_a(v);
     _mm256_zeroupper();
     
-    for(unsigned int j = 0; j != 4; ++j) {
-        printf("%a ", v[j]);
+    for(unsigned int j = 0; j != VectorTraits<T>::lanes; ++j) {
+        printf("%a ", double(v[j]));
     }
 }
 
@@ -0,0 +1,466 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#ifdef EXBLAS_MPI
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "superaccumulator.hpp"
+#include "ExSUM.MPI.hpp"
+#include "transport.hpp"
+
+
+// Types and operators are created once MPI runs, and freed at MPI_Finalize
+static std::mutex mutex;
+static std::map<int, MPI_Datatype> types; // by number of words
+static MPI_Op superacc_op = MPI_OP_NULL;
+static MPI_Op batch_op = MPI_OP_NULL;
+static bool freed_at_finalize = false;   // whether FreeTypes is attached to MPI_COMM_SELF
+
+// Frees the types and operators when MPI_Finalize frees MPI_COMM_SELF, so that the next
+// MPI_Init of the process, if any, creates them again
+static int FreeTypes(MPI_Comm, int self, void *, void *)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::map<int, MPI_Datatype>::iterator it = types.begin(); it != types.end(); ++it)
+        MPI_Type_free(&it->second);
+    types.clear();
+    if (superacc_op != MPI_OP_NULL)
+        MPI_Op_free(&superacc_op);
+    if (batch_op != MPI_OP_NULL)
+        MPI_Op_free(&batch_op);
+    MPI_Comm_free_keyval(&self);
+    freed_at_finalize = false;
+    return MPI_SUCCESS;
+}
+
+// Attaches FreeTypes to MPI_COMM_SELF once, with mutex held
+static void FreeAtFinalize()
+{
+    if (freed_at_finalize)
+        return;
+    int self;
+    MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, &FreeTypes, &self, 0);
+    MPI_Comm_set_attr(MPI_COMM_SELF, self, 0);
+    freed_at_finalize = true;
+}
+
+MPI_Datatype ExSuperaccType(int words)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<int, MPI_Datatype>::iterator it = types.find(words);
+    if (it != types.end())
+        return it->second;
+    FreeAtFinalize();
+    MPI_Datatype type;
+    MPI_Type_contiguous(words, MPI_INT64_T, &type);
+    MPI_Type_commit(&type);
+    types[words] = type;
+    return type;
+}
+
+// Merges len superaccumulators of in into the ones of inout
+static void Merge(void * in, void * inout, int * len, MPI_Datatype * type)
+{
+    int size;
+    MPI_Type_size(*type, &size);
+    int words = size / sizeof(int64_t);
+    for (int64_t k = 0; k != *len; ++k)
+        Superaccumulator::MergeWords((int64_t *)inout + k * words, (int64_t const *)in + k * words, words);
+}
+
+MPI_Op ExSuperaccOp()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (superacc_op == MPI_OP_NULL) {
+        FreeAtFinalize();
+        MPI_Op_create(&Merge, 1, &superacc_op);
+    }
+    return superacc_op;
+}
+
+// Shared window of a node group for superaccumulators of a given size
+struct NodeWindow {
+    MPI_Comm node;     // processes of the node of the calling process
+    MPI_Comm leaders;  // first process of each node, or MPI_COMM_NULL on the others
+    MPI_Win window;    // two alternate regions to add into, followed by the result
+    int64_t * shared;  // start of the window
+    int parity;        // region to add into at the next call
+};
+
+// Processes of a communicator grouped by node, stored as an attribute of the communicator
+struct NodeGroup {
+    MPI_Comm node;
+    MPI_Comm leaders;
+    std::map<int, NodeWindow> windows;  // by number of words
+};
+
+static int keyval = MPI_KEYVAL_INVALID;
+static std::vector<MPI_Comm> grouped; // communicators holding a group, in the order of creation
+
+// Frees the group of a communicator, when the communicator or MPI_COMM_SELF is freed
+static int FreeGroup(MPI_Comm comm, int, void * value, void *)
+{
+    NodeGroup * g = (NodeGroup *)value;
+    for (std::map<int, NodeWindow>::iterator it = g->windows.begin(); it != g->windows.end(); ++it) {
+        MPI_Win_unlock_all(it->second.window);
+        MPI_Win_free(&it->second.window);
+    }
+    MPI_Comm_free(&g->node);
+    if (g->leaders != MPI_COMM_NULL)
+        MPI_Comm_free(&g->leaders);
+    delete g;
+    std::lock_guard<std::mutex> lock(mutex);
+    grouped.erase(std::find(grouped.begin(), grouped.end(), comm));
+    return MPI_SUCCESS;
+}
+
+// Frees the groups of the communicators still alive at MPI_Finalize, which frees MPI_COMM_SELF first
+static int FreeGroups(MPI_Comm, int self, void *, void *)
+{
+    std::vector<MPI_Comm> comms;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        comms = grouped;
+    }
+    for (size_t i = 0; i != comms.size(); ++i)
+        MPI_Comm_delete_attr(comms[i], keyval);
+    MPI_Comm_free_keyval(&keyval);
+    MPI_Comm_free_keyval(&self);
+    return MPI_SUCCESS;
+}
+
+static NodeWindow & Group(MPI_Comm comm, int words)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (keyval == MPI_KEYVAL_INVALID) {
+        int self;
+        MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, &FreeGroup, &keyval, 0);
+        MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, &FreeGroups, &self, 0);
+        MPI_Comm_set_attr(MPI_COMM_SELF, self, 0);
+    }
+
+    // Rank 0 of comm is the first process of its node and of the leaders
+    NodeGroup * g;
+    int found, rank, node_rank;
+    MPI_Comm_get_attr(comm, keyval, &g, &found);
+    MPI_Comm_rank(comm, &rank);
+    if (!found) {
+        g = new NodeGroup();
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &g->node);
+        MPI_Comm_rank(g->node, &node_rank);
+        MPI_Comm_split(comm, (node_rank == 0) ? 0 : MPI_UNDEFINED, rank, &g->leaders);
+        MPI_Comm_set_attr(comm, keyval, g);
+        grouped.push_back(comm);
+    }
+    std::map<int, NodeWindow>::iterator it = g->windows.find(words);
+    if (it != g->windows.end())
+        return it->second;
+
+    NodeWindow & w = g->windows[words];
+    w.node = g->node;
+    w.leaders = g->leaders;
+    MPI_Comm_rank(g->node, &node_rank);
+    MPI_Aint size = (node_rank == 0) ? 3 * words * sizeof(int64_t) : 0;
+    int64_t * base;
+    MPI_Win_allocate_shared(size, sizeof(int64_t), MPI_INFO_NULL, g->node, &base, &w.window);
+    int unit;
+    MPI_Win_shared_query(w.window, 0, &size, &unit, &w.shared);
+    if (node_rank == 0)
+        std::fill(w.shared, w.shared + 3 * words, 0);
+    // The window stays locked until it is freed with the communicator
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, w.window);
+    MPI_Win_sync(w.window);
+    MPI_Barrier(g->node);
+    w.parity = 0;
+    return w;
+}
+
+/*
+ * Reduces the superaccumulators of the processes of comm in two levels. The processes of each node add
+ * theirs into a window of shared memory with atomic additions, then only one process per node takes part
+ * in the reduction among nodes, so that the messages are exchanged between nodes only. The windows and
+ * communicators are set up at the first call for each communicator. Without all, the words of the
+ * processes other than rank 0 are cleared
+ */
+static void ExNodeReduce(int64_t * acc, int words, MPI_Comm comm, bool all)
+{
+    NodeWindow & g = Group(comm, words);
+    // The leader clears a region after reading it; it is added into again two calls later,
+    // after the barrier of the next call, so that a process cannot add into it too early
+    int64_t * sum = g.shared + g.parity * words;
+    int64_t * result = g.shared + 2 * words;
+    g.parity ^= 1;
+
+    Superaccumulator::AccumulateWordsAtomic(sum, acc, words);
+    MPI_Win_sync(g.window);
+    MPI_Barrier(g.node);
+    MPI_Win_sync(g.window);
+
+    std::fill(acc, acc + words, 0);
+    if (g.leaders != MPI_COMM_NULL) {
+        // Merging the sum of the node into zeros normalizes it
+        Superaccumulator::MergeWords(acc, sum, words);
+        std::fill(sum, sum + words, 0);
+        int err, rank;
+        MPI_Comm_rank(g.leaders, &rank);
+        if (all)
+            err = MPI_Allreduce(MPI_IN_PLACE, acc, 1, ExSuperaccType(words), ExSuperaccOp(), g.leaders);
+        else
+            err = MPI_Reduce((rank == 0) ? MPI_IN_PLACE : acc, acc, 1, ExSuperaccType(words), ExSuperaccOp(), 0, g.leaders);
+        if (err != MPI_SUCCESS)
+            fprintf(stderr, "MPI reduction among nodes does not work properly %d\n", err);
+        if (all)
+            std::copy(acc, acc + words, result);
+        else if (rank != 0)
+            std::fill(acc, acc + words, 0);
+    }
+    if (all) {
+        // The result is overwritten only after the barrier of the next call
+        MPI_Win_sync(g.window);
+        MPI_Barrier(g.node);
+        MPI_Win_sync(g.window);
+        std::copy(result, result + words, acc);
+    }
+}
+
+// Compact encoding of a superaccumulator in batched reductions: the range [lo, hi] spanned by the
+// nonzero balanced words of the contributions, followed by the words from lo. As lo and hi are the min
+// and max over the contributions, whether they fit does not depend on the reduction tree, and the sum
+// of fewer than 2^51 contributions takes at most one word more than hi
+static int const window = EXBLAS_BATCH_WINDOW;
+static int const entry = window + 2;
+static int64_t const empty = -1;    // lo of an entry with no nonzero word
+static int64_t const overflow = -2; // lo of an entry not fitting in the window
+
+// Encodes the normalized superaccumulator words into e
+static void Encode(std::vector<int64_t> words, int64_t * e)
+{
+    int n = words.size();
+    Superaccumulator::BalanceWords(&words[0], n);
+    int lo = 0, hi = n - 1;
+    while (lo != n && words[lo] == 0)
+        ++lo;
+    while (hi >= lo && words[hi] == 0)
+        --hi;
+    std::fill(e, e + entry, 0);
+    if (lo > hi) {
+        e[0] = empty;
+    } else if ((hi - lo + 2 > window) || (hi + 1 >= n)) {
+        e[0] = overflow;
+    } else {
+        e[0] = lo;
+        e[1] = hi;
+        std::copy(&words[lo], &words[hi] + 1, e + 2);
+    }
+}
+
+// Decodes e into the words of a superaccumulator of n words
+static std::vector<int64_t> Decode(int64_t const * e, int n)
+{
+    std::vector<int64_t> words(n, 0);
+    if (e[0] >= 0) {
+        for (int j = 0; j != window && e[0] + j < n; ++j)
+            words[e[0] + j] = e[2 + j];
+    }
+    return words;
+}
+
+// Merges len batches of entries of in into the ones of inout
+static void MergeBatch(void * in, void * inout, int * len, MPI_Datatype * type)
+{
+    int size;
+    MPI_Type_size(*type, &size);
+    int n = *len * (size / sizeof(int64_t)) / entry;
+    for (int k = 0; k != n; ++k) {
+        int64_t const * a = (int64_t const *)in + k * entry;
+        int64_t * b = (int64_t *)inout + k * entry;
+        if (a[0] == empty || b[0] == overflow)
+            continue;
+        if (b[0] == empty || a[0] == overflow) {
+            std::copy(a, a + entry, b);
+            continue;
+        }
+        int64_t lo = std::min(a[0], b[0]), hi = std::max(a[1], b[1]);
+        if (hi - lo + 2 > window) {
+            std::fill(b, b + entry, 0);
+            b[0] = overflow;
+            continue;
+        }
+        // Align both on lo, the words above hi + 1 being zero
+        int64_t sum[window] = {0};
+        for (int j = 0; j + a[0] - lo < window; ++j)
+            sum[j + a[0] - lo] += a[2 + j];
+        for (int j = 0; j + b[0] - lo < window; ++j)
+            sum[j + b[0] - lo] += b[2 + j];
+        Superaccumulator::BalanceWords(sum, window);
+        b[0] = lo;
+        b[1] = hi;
+        std::copy(sum, sum + window, b + 2);
+    }
+}
+
+static MPI_Op ExBatchOp()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (batch_op == MPI_OP_NULL) {
+        FreeAtFinalize();
+        MPI_Op_create(&MergeBatch, 1, &batch_op);
+    }
+    return batch_op;
+}
+
+// Reduces count normalized superaccumulators of words words onto all the processes of comm in a single
+// message of their compact encodings. The ones whose words across processes do not fit in the window
+// are reduced again in full by a second collective, which all the processes agree on
+static void ExAllreduceCompact(int64_t * acc, int words, int count, MPI_Comm comm)
+{
+    // The encodings of a message form a single datatype, whose size in bytes is an int
+    int per = INT_MAX / (entry * sizeof(int64_t));
+    if (count > per) {
+        for (int first = 0; first < count; first += per)
+            ExAllreduceCompact(acc + int64_t(first) * words, words, std::min(per, count - first), comm);
+        return;
+    }
+    std::vector<int64_t> local(int64_t(count) * entry), global(int64_t(count) * entry);
+    for (int64_t k = 0; k != count; ++k)
+        Encode(std::vector<int64_t>(acc + k * words, acc + (k + 1) * words), &local[k * entry]);
+    int err = MPI_Allreduce(&local[0], &global[0], 1, ExSuperaccType(count * entry), ExBatchOp(), comm);
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Allreduce does not work properly %d\n", err);
+
+    // The same entries overflow on all the processes
+    std::vector<int> full;
+    std::vector<int64_t> fullwords;
+    for (int64_t k = 0; k != count; ++k) {
+        if (global[k * entry] == overflow) {
+            full.push_back(k);
+            fullwords.insert(fullwords.end(), acc + k * words, acc + (k + 1) * words);
+        } else {
+            std::vector<int64_t> w = Decode(&global[k * entry], words);
+            std::copy(w.begin(), w.end(), acc + k * words);
+        }
+    }
+    if (!full.empty()) {
+        err = MPI_Allreduce(MPI_IN_PLACE, &fullwords[0], full.size(), ExSuperaccType(words), ExSuperaccOp(), comm);
+        if (err != MPI_SUCCESS)
+            fprintf(stderr, "MPI_Allreduce does not work properly %d\n", err);
+        for (size_t i = 0; i != full.size(); ++i)
+            std::copy(&fullwords[i * words], &fullwords[i * words] + words, acc + int64_t(full[i]) * words);
+    }
+}
+
+exblas::MpiTransport::MpiTransport(MPI_Comm comm) :
+    comm(comm)
+{
+}
+
+int exblas::MpiTransport::get_rank() const
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    return rank;
+}
+
+int exblas::MpiTransport::get_size() const
+{
+    int size;
+    MPI_Comm_size(comm, &size);
+    return size;
+}
+
+void exblas::MpiTransport::allreduce(int64_t * acc, int words, int count)
+{
+    if (count > 1) {
+        ExAllreduceCompact(acc, words, count, comm);
+        return;
+    }
+#ifdef EXBLAS_MPI_HIERARCHICAL
+    ExNodeReduce(acc, words, comm, true);
+#else
+    // Partial results are normalized at each merge, whatever the number of processes
+    int err = MPI_Allreduce(MPI_IN_PLACE, acc, count, ExSuperaccType(words), ExSuperaccOp(), comm);
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Allreduce does not work properly %d\n", err);
+#endif
+}
+
+void exblas::MpiTransport::reduce(int64_t * acc, int words, int count)
+{
+#ifdef EXBLAS_MPI_HIERARCHICAL
+    if (count == 1) {
+        ExNodeReduce(acc, words, comm, false);
+        return;
+    }
+#endif
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int err = MPI_Reduce((rank == 0) ? MPI_IN_PLACE : acc, acc, count, ExSuperaccType(words), ExSuperaccOp(), 0, comm);
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Reduce does not work properly %d\n", err);
+    if (rank != 0)
+        std::fill(acc, acc + int64_t(count) * words, 0);
+}
+
+void exblas::MpiTransport::reduce_scatter(int64_t * acc, int words, int const * counts)
+{
+    int err = MPI_Reduce_scatter(MPI_IN_PLACE, acc, counts, ExSuperaccType(words), ExSuperaccOp(), comm);
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Reduce_scatter does not work properly %d\n", err);
+}
+
+void exblas::MpiTransport::allgather(int64_t * values, int const * counts)
+{
+    int size = get_size();
+    std::vector<int> first(size, 0);
+    for (int r = 1; r != size; ++r)
+        first[r] = first[r - 1] + counts[r - 1];
+    int err = MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, values, counts, &first[0], MPI_INT64_T, comm);
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Allgatherv does not work properly %d\n", err);
+}
+
+// Merge in flight of an MpiTransport
+class MpiPending : public exblas::Transport::Pending {
+public:
+    MpiPending() : request(MPI_REQUEST_NULL) {}
+
+    bool test() {
+        int flag = 0;
+        MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+        return flag != 0;
+    }
+
+    void wait() {
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Request request;
+};
+
+exblas::Transport::Pending * exblas::MpiTransport::iallreduce(int64_t * acc, int words)
+{
+    MpiPending * pending = new MpiPending();
+    int err = MPI_Iallreduce(MPI_IN_PLACE, acc, 1, ExSuperaccType(words), ExSuperaccOp(), comm, &pending->request);
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Iallreduce does not work properly %d\n", err);
+    return pending;
+}
+
+// The calling thread may communicate while another one drives the threads of the routines
+bool exblas::MpiTransport::concurrent() const
+{
+    int provided, main;
+    MPI_Query_thread(&provided);
+    MPI_Is_thread_main(&main);
+    return (provided == MPI_THREAD_SERIALIZED) || (provided == MPI_THREAD_MULTIPLE) || ((provided == MPI_THREAD_FUNNELED) && main);
+}
+
+#endif // EXBLAS_MPI
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExSUM.MPI.hpp
+ *  \brief Provides the MPI datatype and reduction operator of superaccumulators,
+ *         upon which MpiTransport merges them. For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXSUM_MPI_HPP_
+#define EXSUM_MPI_HPP_
+
+#ifdef EXBLAS_MPI
+
+#include <mpi.h>
+
+// Number of words of the compact encoding of each superaccumulator in batched reductions
+#ifndef EXBLAS_BATCH_WINDOW
+    #define EXBLAS_BATCH_WINDOW 8
+#endif
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the MPI datatype of a normalized superaccumulator: a contiguous
+ *     block of words 64-bit integers. Created and committed at the first call for each size,
+ *     and freed at MPI_Finalize
+ *
+ * \param words number of words of the superaccumulator, i.e. f_words + e_words
+ */
+MPI_Datatype ExSuperaccType(int words);
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the commutative MPI reduction operator over ExSuperaccType. It adds
+ *     normalized superaccumulators word by word and normalizes the result, so that
+ *     the reduction is exact for any number of processes and any reduction tree
+ */
+MPI_Op ExSuperaccOp();
+
+#endif // EXBLAS_MPI
+
+#endif // EXSUM_MPI_HPP_
@@ -0,0 +1,530 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExSUM.Parallel.hpp
+ *  \brief Provides the parallel skeleton shared by the summation-based routines:
+ *         partitioning among threads, reduction of superaccumulators, and rounding.
+ *         For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXSUM_PARALLEL_HPP_
+#define EXSUM_PARALLEL_HPP_
+
+#include "superaccumulator.hpp"
+#include "ExSUM.FPE.hpp"
+#include "ExContext.hpp"
+#include "ExLoad.hpp"
+
+#include "ExTransport.hpp"
+#include "common.hpp"
+
+#ifdef EXBLAS_TIMING
+    #define iterations 50
+#endif
+
+// Number of floating-point expansions interleaved within each thread
+#ifndef EXBLAS_FPE_INTERLEAVE
+    #define EXBLAS_FPE_INTERLEAVE 1
+#endif
+
+// Software prefetching distance in bytes (0 disables prefetching)
+#ifndef EXBLAS_PREFETCH_DISTANCE
+    #define EXBLAS_PREFETCH_DISTANCE 0
+#endif
+
+// Number of elements after which each thread flushes its floating-point expansions
+#ifndef EXBLAS_CHUNK_SIZE
+    #define EXBLAS_CHUNK_SIZE (1 << 26)
+#endif
+
+
+/**
+ * \brief Final step of summation -- Parallel reduction among threads
+ *
+ *  Threads are merged along a fixed binary tree: at step s, the subtree rooted at
+ *  thread tid2 = tid | 2^(s-1) is merged into the one rooted at tid. Instead of the
+ *  left thread waiting for the right one, both signal their arrival on the counter of
+ *  tid2 and the last one to arrive performs the merge, while the first one leaves.
+ *  Hence no thread ever waits for another, even when threads are descheduled
+ *
+ * \param tid thread ID
+ * \param tnum number of threads
+ * \param arrived arrival counters, reset to zero before the reduction
+ * \param acc returns the superaccumulator of a thread
+ * \param linesize spacing of the counters
+ * \return true for the thread that performed the last merge, acc(0) holding the result
+ */
+template<typename ACC>
+inline static bool Reduction(unsigned int tid, unsigned int tnum, int32_t * arrived,
+    ACC acc, int const linesize)
+{
+    // Root of the subtree accumulated so far by this thread
+    unsigned int root = tid;
+    for(unsigned int s = 1; (1u << (s-1)) < tnum; ++s)
+    {
+        unsigned int tid1 = root & ~((1u << s) - 1);
+        unsigned int tid2 = tid1 | (1u << (s-1));
+        if(tid2 >= tnum) {
+            // No right subtree at this step
+            continue;
+        }
+        // Release our subtree and acquire the other one
+        if(__atomic_fetch_add(&arrived[tid2 * linesize], 1, __ATOMIC_ACQ_REL) == 0) {
+            // First to arrive: the other thread completes this merge and the steps above
+            return false;
+        }
+        acc(tid1).Accumulate(acc(tid2));
+        root = tid1;
+    }
+    return true;
+}
+
+/**
+ * \brief Reduces the per-thread superaccumulators into the one of thread 0.
+ *     With NUMA, the threads of each node are merged first, then the nodes
+ *
+ * \param ctx execution context
+ * \param tid thread ID
+ * \param tnum number of threads
+ */
+inline static void Reduction(ExContext & ctx, unsigned int tid, unsigned int tnum)
+{
+    int const linesize = ExContext::linesize;
+    std::vector<Superaccumulator> & acc = ctx.acc;
+    if((ctx.active_groups == 1) || (int(tnum) != ctx.nthreads)) {
+        Reduction(tid, tnum, &ctx.arrived[0],
+            [&](unsigned int i) -> Superaccumulator & { return acc[i]; }, linesize);
+        return;
+    }
+    int g = ctx.thread_group[tid];
+    int first = ctx.group_first[g];
+    int cnt = ctx.group_first[g+1] - first;
+    if(Reduction(tid - first, cnt, &ctx.arrived[first * linesize],
+        [&](unsigned int i) -> Superaccumulator & { return acc[first + i]; }, linesize)) {
+        Reduction(g, ctx.active_groups, &ctx.group_arrived[0],
+            [&](unsigned int i) -> Superaccumulator & { return acc[ctx.group_first[i]]; }, linesize);
+    }
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Accumulates the elements [l, r) provided by INPUT into acc on the calling thread,
+ *     with NBFPE interleaved floating-point expansions of type CACHE. The range is processed
+ *     in chunks of EXBLAS_CHUNK_SIZE elements, after each of which the expansions are flushed
+ *     into acc, so that the work between two flushes stays bounded for any size of input
+ *
+ * \param in elements to accumulate
+ * \param l first element, a multiple of INPUT::block
+ * \param r end of the elements
+ * \param prefetch software prefetching distance in bytes; 0 disables prefetching
+ * \param acc superaccumulator receiving the result
+ */
+template<typename CACHE, int NBFPE, typename INPUT>
+inline static void ExAccumulateFPE(INPUT const & in, int64_t l, int64_t r, int prefetch, Superaccumulator & acc)
+{
+    int const block = INPUT::block;
+    int64_t const chunk = (int64_t(EXBLAS_CHUNK_SIZE) + block - 1) / block * block;
+
+    for(int64_t c = l; c < r; c += chunk) {
+        int64_t const e = std::min(r, c + chunk);
+        FPExpansionPack<CACHE, NBFPE> cache(acc);
+
+        // Round-robin over NBFPE independent expansions to overlap their twosum chains
+        int64_t i = c;
+        for(; i + block * NBFPE <= e; i += block * NBFPE) {
+            asm ("# myloop");
+            for(int k = 0; k != NBFPE; ++k) {
+                if(prefetch)
+                    in.Prefetch(i + block * k, prefetch);
+                in.Accumulate(cache[k], i + block * k);
+            }
+        }
+        for(; i + block <= e; i += block) {
+            in.Accumulate(cache[0], i);
+        }
+        // Masked loads of the last elements
+        if(i < e) {
+            in.AccumulateTail(cache[0], i, e - i);
+        }
+        cache.Flush();
+    }
+    acc.Normalize();
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Calls f(l, r) on the parts [l, r) of the input processed by a thread: its own part
+ *     with static scheduling, or else the chunks it claims, first from the part of its NUMA
+ *     group, then from the parts of the other groups
+ *
+ * \param ctx execution context, partitioned and with its chunks prepared
+ * \param tid thread ID
+ * \param tnum number of threads
+ * \param align l is a multiple of align elements
+ * \param f function processing the elements [l, r)
+ */
+template<typename F>
+inline static void ExThreadParts(ExContext & ctx, unsigned int tid, unsigned int tnum, int align, F f)
+{
+    int64_t l, r;
+    if(ctx.schedule == exblas::ScheduleStatic) {
+        ctx.ThreadRange(tid, tnum, align, l, r);
+        f(l, r);
+        return;
+    }
+    int g0 = ctx.ThreadGroup(tid, tnum);
+    for(int k = 0; k != ctx.active_groups; ++k) {
+        int g = (g0 + k) % ctx.active_groups;
+        while(ctx.NextChunk(g, l, r))
+            f(l, r);
+    }
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Accumulates the elements provided by INPUT into acc using all the threads.
+ *     Each thread runs NBFPE interleaved floating-point expansions of type CACHE
+ *     over its part of the input, or over the chunks it claims with dynamic scheduling,
+ *     and the per-thread superaccumulators are then reduced.
+ *     Small inputs and nested calls are processed by the calling thread alone
+ *
+ * \param ctx execution context
+ * \param N number of elements
+ * \param in elements to accumulate
+ * \param prefetch software prefetching distance in bytes; 0 disables prefetching
+ * \param acc_fin empty superaccumulator that defines the range and receives the result
+ */
+template<typename CACHE, int NBFPE, typename INPUT>
+void ExParallelFPE(ExContext & ctx, int64_t N, INPUT const & in, int prefetch, Superaccumulator & acc_fin)
+{
+    int const block = INPUT::block;
+    if(ctx.Serial(N)) {
+        ExAccumulateFPE<CACHE, NBFPE>(in, 0, N, prefetch, acc_fin);
+        return;
+    }
+    ctx.Prepare(acc_fin);
+    ctx.Partition(N, in.a, in.Stride(), block);
+    ctx.PrepareChunks(block);
+    std::vector<Superaccumulator> & acc = ctx.acc;
+
+    ctx.pool.Parallel(ctx.nthreads, [&](unsigned int tid, unsigned int tnum) {
+        ExBinding binding(ctx, tid, tnum);
+
+        // With dynamic scheduling, each chunk gets fresh expansions flushed into acc[tid]
+        ExThreadParts(ctx, tid, tnum, block, [&](int64_t l, int64_t r) {
+            ExAccumulateFPE<CACHE, NBFPE>(in, l, r, prefetch, acc[tid]);
+        });
+
+        Reduction(ctx, tid, tnum);
+    });
+    acc_fin = acc[0];
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Accumulates the elements provided by INPUT into acc with superaccumulators only.
+ *     Each thread accumulates its part of the input into its own superaccumulator,
+ *     and the per-thread superaccumulators are then reduced.
+ *     Small inputs and nested calls are processed by the calling thread alone
+ *
+ * \param ctx execution context
+ * \param N number of elements
+ * \param in elements to accumulate
+ * \param acc_fin empty superaccumulator that defines the range and receives the result
+ */
+template<typename INPUT>
+void ExParallelSuperacc(ExContext & ctx, int64_t N, INPUT const & in, Superaccumulator & acc_fin)
+{
+    if(ctx.Serial(N)) {
+        for(int64_t k = 0; k < N; ++k) {
+            in.Accumulate(acc_fin, k);
+        }
+        acc_fin.Normalize();
+        return;
+    }
+    ctx.Prepare(acc_fin);
+    ctx.Partition(N, in.a, in.Stride(), 1);
+    ctx.PrepareChunks(1);
+    std::vector<Superaccumulator> & acc = ctx.acc;
+
+    ctx.pool.Parallel(ctx.nthreads, [&](unsigned int tid, unsigned int tnum) {
+        ExBinding binding(ctx, tid, tnum);
+
+        ExThreadParts(ctx, tid, tnum, 1, [&](int64_t l, int64_t r) {
+            for(int64_t k = l; k < r; ++k) {
+                in.Accumulate(acc[tid], k);
+            }
+        });
+        acc[tid].Normalize();
+
+        Reduction(ctx, tid, tnum);
+    });
+    acc_fin = acc[0];
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Reduces the superaccumulators of the processes of MPI_COMM_WORLD onto its rank 0,
+ *     or onto all of them with ReduceAll. With a transport, merges them among all its participants
+ *     instead, with or without MPI. Does nothing without MPI nor transport, or when the caller
+ *     merges the result itself
+ *
+ * \param ctx execution context
+ * \param acc superaccumulator
+ */
+inline void ExReduce(ExContext & ctx, Superaccumulator & acc)
+{
+    if (ctx.deferred)
+        return;
+    if (ctx.transport)
+        ExMerge(acc, *ctx.transport, true, ctx.scratch);
+#ifdef EXBLAS_MPI
+    else
+        ExMerge(acc, ctx.world, ctx.reduce == exblas::ReduceAll, ctx.scratch);
+#endif
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Rounds the superaccumulator to the nearest number of type R
+ *
+ * \param acc superaccumulator
+ * \return Correctly rounded result
+ */
+template<typename R> R ExRound(Superaccumulator & acc);
+
+template<> inline double ExRound<double>(Superaccumulator & acc) {
+    return acc.Round();
+}
+
+template<> inline float ExRound<float>(Superaccumulator & acc) {
+    return acc.RoundFloat();
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Our alg with superaccumulators only
+ *
+ * \param ctx execution context
+ * \param N number of elements
+ * \param in elements to sum
+ * \param zero empty superaccumulator covering the range of the elements
+ * \return Contains the reproducible and accurate sum rounded to R
+ */
+template<typename R, typename INPUT>
+R ExSUMSuperacc(ExContext & ctx, int64_t N, INPUT const & in, Superaccumulator const & zero) {
+    R dacc;
+#ifdef EXBLAS_TIMING
+    double t, mint = 10000;
+    uint64_t tstart, tend;
+    for(int iter = 0; iter != iterations; ++iter) {
+    	tstart = rdtsc();
+#endif
+        Superaccumulator & acc = ctx.result;
+        acc = zero;
+        ExParallelSuperacc(ctx, N, in, acc);
+        ExReduce(ctx, acc);
+        dacc = ExRound<R>(acc);
+
+#ifdef EXBLAS_TIMING
+        tend = rdtsc();
+        t = double(tend - tstart) / N;
+        mint = std::min(mint, t);
+    }
+    fprintf(stderr, "%f ", mint);
+#endif
+
+    return dacc;
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Our alg with floating-point expansions of type CACHE and superaccumulators when needed.
+ *     NBFPE independent floating-point expansions are interleaved within each thread
+ *
+ * \param ctx execution context
+ * \param N number of elements
+ * \param in elements to sum
+ * \param zero empty superaccumulator covering the range of the elements
+ * \param prefetch software prefetching distance in bytes; 0 disables prefetching
+ * \return Contains the reproducible and accurate sum rounded to R
+ */
+template<typename CACHE, int NBFPE, typename R, typename INPUT>
+R ExSUMFPE(ExContext & ctx, int64_t N, INPUT const & in, Superaccumulator const & zero, int prefetch) {
+    R dacc;
+#ifdef EXBLAS_TIMING
+    double t, mint = 10000;
+    uint64_t tstart, tend;
+    for(int iter = 0; iter != iterations; ++iter) {
+        tstart = rdtsc();
+#endif
+        Superaccumulator & acc = ctx.result;
+        acc = zero;
+        ExParallelFPE<CACHE, NBFPE>(ctx, N, in, prefetch, acc);
+        ExReduce(ctx, acc);
+        dacc = ExRound<R>(acc);
+
+#ifdef EXBLAS_TIMING
+        tend = rdtsc();
+        t = double(tend - tstart) / N;
+        mint = std::min(mint, t);
+    }
+    fprintf(stderr, "%f ", mint);
+#endif
+
+    return dacc;
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Brings fpe into the sizes of floating-point expansions the routines provide: negative
+ *     sizes select superaccumulators only, and sizes above 8 the expansions of size 8. As every
+ *     size gives the same correctly rounded result, the call still returns it
+ *
+ * \param fpe size of floating-point expansion
+ * \return Size of floating-point expansion, in the interval [0, 8]
+ */
+inline int ExClampFPE(int fpe)
+{
+    return std::min(std::max(fpe, 0), 8);
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Selects the floating-point expansion of vectors V matching fpe and early_exit
+ *
+ * \param ctx execution context
+ * \param N number of elements
+ * \param in elements to sum
+ * \param zero empty superaccumulator covering the range of the elements
+ * \param fpe size of floating-point expansion, brought into the interval [2, 8] (sizes below 2
+ *     use expansions of size 2 and sizes above 8 those of size 8, with the same result)
+ * \param early_exit specifies the optimization technique
+ * \return Contains the reproducible and accurate sum rounded to R
+ */
+template<typename V, typename R, typename INPUT>
+R ExSUMFPEDispatch(ExContext & ctx, int64_t N, INPUT const & in, Superaccumulator const & zero, int fpe, bool early_exit) {
+    fpe = std::min(std::max(fpe, 2), 8);
+    if (early_exit) {
+        if (fpe <= 4)
+            return ExSUMFPE<FPExpansionVect<V, 4, FPExpansionTraits<true> >, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        if (fpe <= 6)
+            return ExSUMFPE<FPExpansionVect<V, 6, FPExpansionTraits<true> >, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        return ExSUMFPE<FPExpansionVect<V, 8, FPExpansionTraits<true> >, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+    }
+    switch (fpe) {
+        case 2: return ExSUMFPE<FPExpansionVect<V, 2>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 3: return ExSUMFPE<FPExpansionVect<V, 3>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 4: return ExSUMFPE<FPExpansionVect<V, 4>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 5: return ExSUMFPE<FPExpansionVect<V, 5>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 6: return ExSUMFPE<FPExpansionVect<V, 6>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        case 7: return ExSUMFPE<FPExpansionVect<V, 7>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        default: return ExSUMFPE<FPExpansionVect<V, 8>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+    }
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Turns the run-time flags of the floating-point expansion techniques into the
+ *     compile-time FPExpansionTraits, one flag at a time. I is the index of the next
+ *     flag and B the flags selected so far, in the order of FPExpansionTraits
+ */
+template<int I, bool... B>
+struct FPExpansionTraitsSelector {
+    template<typename V, typename R, typename INPUT>
+    static R Run(ExContext & ctx, int64_t N, INPUT const & in, Superaccumulator const & zero, int fpe, bool const * flags) {
+        // With FMA (AVX2 and later) twosum ignores Biased2Sum, so both of its values share one instantiation
+        static bool constexpr fixed = (I == 5 && INSTRSET > 7);
+        if (flags[I])
+            return FPExpansionTraitsSelector<I + 1, B..., true>::template Run<V, R>(ctx, N, in, zero, fpe, flags);
+        return FPExpansionTraitsSelector<I + 1, B..., fixed>::template Run<V, R>(ctx, N, in, zero, fpe, flags);
+    }
+};
+
+template<bool... B>
+struct FPExpansionTraitsSelector<8, B...> {
+    template<typename V, typename R, typename INPUT>
+    static R Run(ExContext & ctx, int64_t N, INPUT const & in, Superaccumulator const & zero, int fpe, bool const * flags) {
+        typedef FPExpansionTraits<B...> TRAITS;
+        switch (std::min(std::max(fpe, 2), 8)) {
+            case 2: return ExSUMFPE<FPExpansionVect<V, 2, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+            case 3: return ExSUMFPE<FPExpansionVect<V, 3, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+            case 4: return ExSUMFPE<FPExpansionVect<V, 4, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+            case 5: return ExSUMFPE<FPExpansionVect<V, 5, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+            case 6: return ExSUMFPE<FPExpansionVect<V, 6, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+            case 7: return ExSUMFPE<FPExpansionVect<V, 7, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+            default: return ExSUMFPE<FPExpansionVect<V, 8, TRAITS>, EXBLAS_FPE_INTERLEAVE, R>(ctx, N, in, zero, EXBLAS_PREFETCH_DISTANCE);
+        }
+    }
+};
+
+#ifdef EXBLAS_MPI
+/**
+ * \ingroup ExSUM
+ * \brief Returns the MPI datatype of the elements pointed to
+ */
+inline MPI_Datatype ExMPIType(double const *) { return MPI_DOUBLE; }
+inline MPI_Datatype ExMPIType(float const *) { return MPI_FLOAT; }
+
+/**
+ * \ingroup ExSUM
+ * \brief Distributes a vector stored on the root process among the processes of MPI_COMM_WORLD,
+ *     as evenly as possible. The root keeps the first part of a contiguous vector in place; it packs
+ *     the elements of a vector with another increment in buffer first, in the order of BLAS.
+ *     The other processes receive their parts in buffer. The buffer is reused from one call to another
+ *
+ * \param buffer memory receiving the packed vector on the root, or the local part on the other processes
+ * \param Ng global vector size
+ * \param ag global vector (significant only on the root)
+ * \param inca increment between the elements of ag, possibly negative
+ * \param offset position of the vector from the start of ag
+ * \param a contiguous local part of the vector
+ * \return Size of the local part of the vector
+ */
+template<typename T>
+int ExScatter(std::vector<char> & buffer, int Ng, T *ag, int inca, int offset, T *& a) {
+    MPI_Datatype type = ExMPIType(ag);
+    int np = 1, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &p);
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+    // The first Ng % np processes get one more element
+    std::vector<int> counts(np), displs(np);
+    for (int i = 0; i != np; ++i) {
+        counts[i] = Ng / np + (i < Ng % np);
+        displs[i] = (i == 0) ? 0 : displs[i-1] + counts[i-1];
+    }
+    int N = counts[p];
+
+    int err;
+    if (p == 0) {
+        a = ag + offset;
+        if (inca != 1) {
+            buffer.resize(std::max(Ng, 1) * sizeof(T));
+            T *first = ExFirst(ag, Ng, inca, offset);
+            a = (T *)&buffer[0];
+            for (int i = 0; i != Ng; ++i)
+                a[i] = first[int64_t(i) * inca];
+        }
+        err = MPI_Scatterv(a, &counts[0], &displs[0], type, MPI_IN_PLACE, N, type, 0, MPI_COMM_WORLD);
+    } else {
+        buffer.resize(std::max(N, 1) * sizeof(T));
+        a = (T *)&buffer[0];
+        err = MPI_Scatterv(0, 0, 0, type, a, N, type, 0, MPI_COMM_WORLD);
+    }
+    if (err != MPI_SUCCESS)
+        fprintf(stderr, "MPI_Scatterv does not work properly %d\n", err);
+
+    return N;
+}
+#endif
+
+#endif // EXSUM_PARALLEL_HPP_
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+
+#include "ExSUM.hpp"
+#include "blas1.hpp"
+
+
+/*
+ * Parallel summation using our algorithm with a chosen variant of floating-point expansions
+ * With EXBLAS_FPE_VARIANTS, every combination of FPExpansionTraits is instantiated for fpe
+ * in [2, 8], which takes minutes to compile; hence this file is kept apart from the main entry points.
+ * Otherwise, only the early-exit technique is selected, the others being the default ones
+ */
+double exsum(int Ng, double *ag, int inca, int offset, int fpe, ExFPEOptions const & opts) {
+    return exsum(exblas::default_context(), Ng, ag, inca, offset, fpe, opts);
+}
+
+double exsum(exblas::Context & context, int Ng, double *ag, int inca, int offset, int fpe, ExFPEOptions const & opts) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    int N;
+    SumInput<double, Vec4d> in = ExSumInput<Vec4d>(ctx, Ng, ag, inca, offset, N);
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    // with superaccumulators only
+    if (fpe < 2)
+        return ExSUMSuperacc<double>(ctx, N, in, zero);
+
+#ifdef EXBLAS_FPE_VARIANTS
+    // In the order of FPExpansionTraits
+    bool const flags[8] = {opts.early_exit, opts.flush_hi, opts.horz_2sum, opts.check_range_first,
+        opts.conditional_swap, opts.biased_2sum, opts.sort, opts.victim_cache};
+    return FPExpansionTraitsSelector<0>::Run<Vec4d, double>(ctx, N, in, zero, fpe, flags);
+#else
+    // The other techniques fall back to the default ones, which give the same result
+    return ExSUMFPEDispatch<Vec4d, double>(ctx, N, in, zero, fpe, opts.early_exit);
+#endif
+}
@@ -11,10 +11,6 @@
 #include "ExSUM.hpp"
 #include "blas1.hpp"
 
-#ifdef EXBLAS_TIMING
-    #define iterations 50
-#endif
-
 
 /*
  * Parallel summation using our algorithm
@@ -23,219 +19,273 @@
  * early_exit corresponds to the early-exit technique
  */
 double exsum(int Ng, double *ag, int inca, int offset, int fpe, bool early_exit) {
-#ifdef EXBLAS_MPI
-    int np = 1, p, err;
-    MPI_Comm_rank(MPI_COMM_WORLD, &p);
-    MPI_Comm_size(MPI_COMM_WORLD, &np);
-#endif
-    int nthread = tbb::task_scheduler_init::automatic;
-    tbb::task_scheduler_init tbbinit(nthread);
+    return exsum(exblas::default_context(), Ng, ag, inca, offset, fpe, early_exit);
+}
 
-    if (fpe < 0) {
-        fprintf(stderr, "Size of floating-point expansion should be a positive number. Preferably, it should be in the interval [2, 8]\n");
-        exit(1);
-    }
+double exsum(exblas::Context & context, int Ng, double *ag, int inca, int offset, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
 
     int N;
-    double *a;
-#ifdef EXBLAS_MPI
-    Superaccumulator acc, acc_fin;
-    N = Ng / np + Ng % np;
-
-    a = (double *)_mm_malloc(N * sizeof(double), 32);
-    if (!a)
-        fprintf(stderr, "Cannot allocate memory for per process array\n");
-
-    int i;
-    if (p == 0) {
-        //distribute
-        a = ag;
-        ag = ag + N;
-        for (i = 1; i < np; i++) {
-            err = MPI_Send(ag + (i - 1)  * (N - Ng % np), N - Ng % np, MPI_DOUBLE, i, 0, MPI_COMM_WORLD);
-            if (err != MPI_SUCCESS)
-                fprintf(stderr, "MPI_Send does not word properly %d\n", err);
-        }
-    } else {
-        MPI_Status status;
-        err = MPI_Recv(a, N - Ng % np, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, &status);
-        if (err != MPI_SUCCESS)
-            fprintf(stderr, "MPI_Recv does not word properly %d\n", err);
-    }
-#else
-    N = Ng;
-    a = ag;
-#endif
+    SumInput<double, Vec4d> in = ExSumInput<Vec4d>(ctx, Ng, ag, inca, offset, N);
+    static const Superaccumulator zero(e_bits, f_bits);
 
     // with superaccumulators only
     if (fpe < 2)
-        return ExSUMSuperacc(N, a, inca, offset);
-
-    if (early_exit) {
-        if (fpe <= 4)
-            return (ExSUMFPE<FPExpansionVect<Vec4d, 4, FPExpansionTraits<true> > >)(N, a, inca, offset);
-        if (fpe <= 6)
-            return (ExSUMFPE<FPExpansionVect<Vec4d, 6, FPExpansionTraits<true> > >)(N, a, inca, offset);
-        if (fpe <= 8)
-            return (ExSUMFPE<FPExpansionVect<Vec4d, 8, FPExpansionTraits<true> > >)(N, a, inca, offset);
-    } else { // ! early_exit
-        if (fpe == 2) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 2> >)(N, a, inca, offset);
-        if (fpe == 3) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 3> >)(N, a, inca, offset);
-        if (fpe == 4) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 4> >)(N, a, inca, offset);
-        if (fpe == 5) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 5> >)(N, a, inca, offset);
-        if (fpe == 6) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 6> >)(N, a, inca, offset);
-        if (fpe == 7) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 7> >)(N, a, inca, offset);
-        if (fpe == 8) 
-	    return (ExSUMFPE<FPExpansionVect<Vec4d, 8> >)(N, a, inca, offset);
-    }
+        return ExSUMSuperacc<double>(ctx, N, in, zero);
 
-    return 0.0;
+    return ExSUMFPEDispatch<Vec4d, double>(ctx, N, in, zero, fpe, early_exit);
 }
 
 /*
- * Our alg with superaccumulators only
+ * Parallel summation of single-precision elements using our algorithm
+ * The elements are widened exactly to double on load, so the result is
+ * the correctly rounded double-precision sum without a converted copy of ag
  */
-double ExSUMSuperacc(int N, double *a, int inca, int offset) {
-    double dacc;
-#ifdef EXBLAS_TIMING
-    double t, mint = 10000;
-    uint64_t tstart, tend;
-    for(int iter = 0; iter != iterations; ++iter) {
-    	tstart = rdtsc();
-#endif
+double exsum(int Ng, float *ag, int inca, int offset, int fpe, bool early_exit) {
+    return exsum(exblas::default_context(), Ng, ag, inca, offset, fpe, early_exit);
+}
 
-        TBBlongsum tbbsum(a);
-        tbb::parallel_reduce(tbb::blocked_range<size_t>(0, N, inca), tbbsum);
-#ifdef EXBLAS_MPI
-        tbbsum.acc.Normalize();
-        std::vector<int64_t> result(tbbsum.acc.get_f_words() + tbbsum.acc.get_e_words(), 0);
-        //MPI_Reduce((int64_t *) &tbbsum.acc.accumulator[0], (int64_t *) &acc_fin.accumulator[0], get_f_words() + get_e_words(), MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-        MPI_Reduce(&(tbbsum.acc.get_accumulator()[0]), &(result[0]), tbbsum.acc.get_f_words() + tbbsum.acc.get_e_words(), MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-
-        Superaccumulator acc_fin(result);
-        dacc = acc_fin.Round();
-#else
-        dacc = tbbsum.acc.Round();
-#endif
+double exsum(exblas::Context & context, int Ng, float *ag, int inca, int offset, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
 
-#ifdef EXBLAS_TIMING
-        tend = rdtsc();
-        t = double(tend - tstart) / N;
-        mint = std::min(mint, t);
-    }
-    fprintf(stderr, "%f ", mint);
-#endif
+    fpe = ExClampFPE(fpe);
+
+    int N;
+    SumInput<float, Vec4d> in = ExSumInput<Vec4d>(ctx, Ng, ag, inca, offset, N);
+    // Sums of single-precision numbers stay within the single-precision exponent range
+    static const Superaccumulator zero(e_bits_f, f_bits_f);
+
+    // with superaccumulators only
+    if (fpe < 2)
+        return ExSUMSuperacc<double>(ctx, N, in, zero);
 
-    return dacc;
+    return ExSUMFPEDispatch<Vec4d, double>(ctx, N, in, zero, fpe, early_exit);
 }
 
-/**
- * \brief Parallel reduction step
- *
- * \param step step among threads
- * \param tid1 id of the first thread
- * \param tid2 id of the second thread
- * \param acc1 superaccumulator of the first thread
- * \param acc2 superaccumulator of the second thread
+/*
+ * Parallel summation of single-precision elements using our algorithm
+ * Same as exsum, but with floating-point expansions of Vec8f and
+ * the result correctly rounded to single precision
  */
-inline static void ReductionStep(int step, int tid1, int tid2, Superaccumulator * acc1, Superaccumulator * acc2,
-    int volatile * ready1, int volatile * ready2)
-{
-    _mm_prefetch((char const*)ready2, _MM_HINT_T0);
-    // Wait for thread 2
-    while(*ready2 < step) {
-        // wait
-        _mm_pause();
-    }
-    acc1->Accumulate(*acc2);
+float exsumf(int Ng, float *ag, int inca, int offset, int fpe, bool early_exit) {
+    return exsumf(exblas::default_context(), Ng, ag, inca, offset, fpe, early_exit);
+}
+
+float exsumf(exblas::Context & context, int Ng, float *ag, int inca, int offset, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    int N;
+    SumInput<float, Vec8f> in = ExSumInput<Vec8f>(ctx, Ng, ag, inca, offset, N);
+    static const Superaccumulator zero(e_bits_f, f_bits_f);
+
+    // with superaccumulators only
+    if (fpe < 2)
+        return ExSUMSuperacc<float>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec8f, float>(ctx, N, in, zero, fpe, early_exit);
 }
 
-/**
- * \brief Final step of summation -- Parallel reduction among threads
- *
- * \param tid thread ID
- * \param tnum number of threads
- * \param acc superaccumulator
+/*
+ * Parallel summation of vectors with 64-bit sizes using our algorithm
+ * Each thread flushes its floating-point expansions every EXBLAS_CHUNK_SIZE elements.
+ * With MPI, each process sums its own part of the vector, without scattering
  */
-inline static void Reduction(unsigned int tid, unsigned int tnum, std::vector<int32_t>& ready,
-    std::vector<Superaccumulator>& acc, int const linesize)
-{
-    // Custom reduction
-    for(unsigned int s = 1; (1 << (s-1)) < tnum; ++s) 
-    {
-        int32_t volatile * c = &ready[tid * linesize];
-        ++*c;
-        if(tid % (1 << s) == 0) {
-            unsigned int tid2 = tid | (1 << (s-1));
-            if(tid2 < tnum) {
-                //acc[tid2].Prefetch(); // No effect...
-                ReductionStep(s, tid, tid2, &acc[tid], &acc[tid2],
-                    &ready[tid * linesize], &ready[tid2 * linesize]);
-            }
-        }
+double exsum_64(int64_t N, double *a, int64_t inca, int64_t offset, int fpe, bool early_exit) {
+    return exsum_64(exblas::default_context(), N, a, inca, offset, fpe, early_exit);
+}
+
+double exsum_64(exblas::Context & context, int64_t N, double *a, int64_t inca, int64_t offset, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    // The order of the elements does not matter to the sum, so negative increments are reversed
+    SumInput<double, Vec4d> in(a + offset, std::abs(inca));
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    // with superaccumulators only
+    if (fpe < 2)
+        return ExSUMSuperacc<double>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec4d, double>(ctx, N, in, zero, fpe, early_exit);
+}
+
+/*
+ * Parallel summation of single-precision vectors with 64-bit sizes using our algorithm
+ * Same as exsum_64, with the result correctly rounded to single precision
+ */
+float exsumf_64(int64_t N, float *a, int64_t inca, int64_t offset, int fpe, bool early_exit) {
+    return exsumf_64(exblas::default_context(), N, a, inca, offset, fpe, early_exit);
+}
+
+float exsumf_64(exblas::Context & context, int64_t N, float *a, int64_t inca, int64_t offset, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    // The order of the elements does not matter to the sum, so negative increments are reversed
+    SumInput<float, Vec8f> in(a + offset, std::abs(inca));
+    static const Superaccumulator zero(e_bits_f, f_bits_f);
+
+    // with superaccumulators only
+    if (fpe < 2)
+        return ExSUMSuperacc<float>(ctx, N, in, zero);
+
+    return ExSUMFPEDispatch<Vec8f, float>(ctx, N, in, zero, fpe, early_exit);
+}
+
+// Sums the local elements into ctx.result, leaving their merge among participants to the caller
+static void ExLocalSum(ExContext & ctx, int64_t local_n, double *local_a, int fpe, bool early_exit) {
+    SumInput<double, Vec4d> in(local_a, 1);
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    ctx.result = zero;
+    ctx.deferred = true;
+    if (fpe < 2)
+        ExSUMSuperacc<double>(ctx, local_n, in, zero);
+    else
+        ExSUMFPEDispatch<Vec4d, double>(ctx, local_n, in, zero, fpe, early_exit);
+    ctx.deferred = false;
+}
+
+/*
+ * Parallel summation of a vector distributed over the participants of transport using our algorithm
+ * Each participant sums its local elements in place; only the superaccumulators travel to participant 0
+ */
+double exsum_dist(int64_t local_n, double *local_a, exblas::Transport & transport, int fpe, bool early_exit) {
+    return exsum_dist(exblas::default_context(), local_n, local_a, transport, fpe, early_exit);
+}
+
+double exsum_dist(exblas::Context & context, int64_t local_n, double *local_a, exblas::Transport & transport, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    ExLocalSum(ctx, local_n, local_a, fpe, early_exit);
+    ExMerge(ctx.result, transport, ctx.reduce == exblas::ReduceAll, ctx.scratch);
+    return ctx.result.Round();
+}
+
+/*
+ * Non-blocking parallel summation of a distributed vector using our algorithm
+ * The local superaccumulator is computed before returning; its merge onto all the participants is left in flight
+ */
+exblas::Request exsum_iallreduce(int64_t local_n, double *local_a, exblas::Transport & transport, int fpe, bool early_exit) {
+    return exsum_iallreduce(exblas::default_context(), local_n, local_a, transport, fpe, early_exit);
+}
+
+exblas::Request exsum_iallreduce(exblas::Context & context, int64_t local_n, double *local_a, exblas::Transport & transport, int fpe, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    ExLocalSum(ctx, local_n, local_a, fpe, early_exit);
+    return ExIallreduce(ctx.result, transport);
+}
+
+/*
+ * Parallel summation of several distributed vectors using our algorithm
+ * Their superaccumulators are merged onto all the participants at once
+ */
+void exsum_dist_batch(int count, int64_t local_n, double * const *local_a, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    exsum_dist_batch(exblas::default_context(), count, local_n, local_a, transport, fpe, results, early_exit);
+}
+
+void exsum_dist_batch(exblas::Context & context, int count, int64_t local_n, double * const *local_a, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    std::vector<Superaccumulator> accs;
+    for (int k = 0; k != count; ++k) {
+        ExLocalSum(ctx, local_n, local_a[k], fpe, early_exit);
+        accs.push_back(ctx.result);
     }
+    ExAllreduceBatch(accs, transport, results);
 }
 
-template<typename CACHE> double ExSUMFPE(int N, double *a, int inca, int offset) {
-    // OpenMP sum+reduction
-    int const linesize = 16;    // * sizeof(int32_t)
-    int maxthreads = omp_get_max_threads();
-    double dacc;
-#ifdef EXBLAS_TIMING
-    double t, mint = 10000;
-    uint64_t tstart, tend;
-    for(int iter = 0; iter != iterations; ++iter) {
-        tstart = rdtsc();
-#endif
-        std::vector<Superaccumulator> acc(maxthreads);
-        std::vector<int32_t> ready(maxthreads * linesize);
-    
-        #pragma omp parallel
-        {
-            unsigned int tid = omp_get_thread_num();
-            unsigned int tnum = omp_get_num_threads();
-
-            CACHE cache(acc[tid]);
-            *(int32_t volatile *)(&ready[tid * linesize]) = 0;  // Race here, who cares?
-
-            int l = ((tid * int64_t(N)) / tnum) & ~7ul;
-            int r = ((((tid+1) * int64_t(N)) / tnum) & ~7ul) - 1;
-
-            for(int i = l; i < r; i+=8) {
-                asm ("# myloop");
-                cache.Accumulate(Vec4d().load_a(a + i), Vec4d().load_a(a + i + 4));
-            }
-            cache.Flush();
-            acc[tid].Normalize();
-
-            Reduction(tid, tnum, ready, acc, linesize);
+/*
+ * Parallel summation of steps batches of count distributed vectors using our algorithm
+ * The threads sum the vectors of the next batch while the superaccumulators of the current one are merged
+ */
+void exsum_dist_pipeline(int steps, int count, int64_t local_n, double * const *local_a, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    exsum_dist_pipeline(exblas::default_context(), steps, count, local_n, local_a, transport, fpe, results, early_exit);
+}
+
+void exsum_dist_pipeline(exblas::Context & context, int steps, int count, int64_t local_n, double * const *local_a, exblas::Transport & transport, int fpe, double *results, bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    ExPipelineBatches(ctx.helper, steps, count, transport, results, [&](int step, std::vector<Superaccumulator> & accs) {
+        accs.clear();
+        for (int k = 0; k != count; ++k) {
+            ExLocalSum(ctx, local_n, local_a[int64_t(step) * count + k], fpe, early_exit);
+            accs.push_back(ctx.result);
         }
+    });
+}
+
 #ifdef EXBLAS_MPI
-        acc[0].Normalize();
-        std::vector<int64_t> result(acc[0].get_f_words() + acc[0].get_e_words(), 0);
-        MPI_Reduce(&(acc[0].get_accumulator()[0]), &(result[0]), acc[0].get_f_words() + acc[0].get_e_words(), MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-        //MPI_Reduce((int64_t *) &acc[0].accumulator[0], (int64_t *) &acc_fin.accumulator[0], get_f_words() + get_e_words(), MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-
-        Superaccumulator acc_fin(result);
-        dacc = acc_fin.Round();
-#else
-        dacc = acc[0].Round();
-#endif    
-
-#ifdef EXBLAS_TIMING
-        tend = rdtsc();
-        t = double(tend - tstart) / N;
-        mint = std::min(mint, t);
-    }
-    fprintf(stderr, "%f ", mint);
-#endif
+/*
+ * Same summations over the processes of comm, merged by an MpiTransport
+ */
+double exsum_dist(int64_t local_n, double *local_a, MPI_Comm comm, int fpe, bool early_exit) {
+    return exsum_dist(exblas::default_context(), local_n, local_a, comm, fpe, early_exit);
+}
 
-    return dacc;
+double exsum_dist(exblas::Context & context, int64_t local_n, double *local_a, MPI_Comm comm, int fpe, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    return exsum_dist(context, local_n, local_a, transport, fpe, early_exit);
 }
 
+exblas::Request exsum_iallreduce(int64_t local_n, double *local_a, MPI_Comm comm, int fpe, bool early_exit) {
+    return exsum_iallreduce(exblas::default_context(), local_n, local_a, comm, fpe, early_exit);
+}
+
+exblas::Request exsum_iallreduce(exblas::Context & context, int64_t local_n, double *local_a, MPI_Comm comm, int fpe, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    return exsum_iallreduce(context, local_n, local_a, transport, fpe, early_exit);
+}
+
+void exsum_dist_batch(int count, int64_t local_n, double * const *local_a, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exsum_dist_batch(exblas::default_context(), count, local_n, local_a, comm, fpe, results, early_exit);
+}
+
+void exsum_dist_batch(exblas::Context & context, int count, int64_t local_n, double * const *local_a, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    exsum_dist_batch(context, count, local_n, local_a, transport, fpe, results, early_exit);
+}
+
+void exsum_dist_pipeline(int steps, int count, int64_t local_n, double * const *local_a, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exsum_dist_pipeline(exblas::default_context(), steps, count, local_n, local_a, comm, fpe, results, early_exit);
+}
+
+void exsum_dist_pipeline(exblas::Context & context, int steps, int count, int64_t local_n, double * const *local_a, MPI_Comm comm, int fpe, double *results, bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    exsum_dist_pipeline(context, steps, count, local_n, local_a, transport, fpe, results, early_exit);
+}
+#endif
+
+/*
+ * Asynchronous parallel summation using our algorithm
+ * The vector is split into chunks queued on the thread pool, so that
+ * several calls in flight share the threads. The result is the same as exsum's
+ */
+std::future<double> exsum_async(int N, double *a, int inca, int offset, int fpe, bool early_exit) {
+    fpe = ExClampFPE(fpe);
+
+    // The order of the elements does not matter to the sum, so negative increments are reversed
+    SumInput<double, Vec4d> in(a + offset, std::abs(inca));
+    static const Superaccumulator zero(e_bits, f_bits);
+
+    // with superaccumulators only
+    if (fpe < 2)
+        return ExSUMSuperaccAsync<double>(N, in, zero);
+
+    return ExSUMFPEAsyncDispatch<Vec4d, double>(N, in, zero, fpe, early_exit);
+}
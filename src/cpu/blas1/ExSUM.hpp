@@ -16,89 +16,144 @@
 #ifndef EXSUM_HPP_
 #define EXSUM_HPP_
 
-#include "superaccumulator.hpp"
-#include "ExSUM.FPE.hpp"
-#define TBB_PREVIEW_DETERMINISTIC_REDUCE 1
-#include <tbb/blocked_range.h>
-#include <tbb/parallel_reduce.h>
-#include <tbb/task_scheduler_init.h>
-#include <omp.h>
+#include "ExSUM.Async.hpp"
+#include "ExLoad.hpp"
 
-#ifdef EXBLAS_MPI
-    #include <mpi.h>
-#endif
-#include "common.hpp"
 
+/**
+ * \class SumInput
+ * \ingroup ExSUM
+ * \brief Loads elements of type T from a vector with any increment and alignment and feeds
+ *  them to floating-point expansions of vectors V or to a superaccumulator. Element i is
+ *  a[i * inc]; the last step of a range reads its n < block elements with AccumulateTail.
+ *  For internal use
+ */
+template<typename T, typename V> struct SumInput;
 
 /**
- * \class TBBlongsum
  * \ingroup ExSUM
- * \brief This class is meant to be used in our multi-level reproducible and 
- *  accurate algorithm with superaccumulators only
+ * \brief Double-precision elements accumulated with Vec4d expansions
  */
-class TBBlongsum {
-    double* a; /**< a real vector to sum */
-public:
-    Superaccumulator acc; /**< supperaccumulator */
-
-    /**
-     * The main function that performs summation of the vector's elelements into the 
-     * superaccumulator
-     */
-    void operator()(tbb::blocked_range<size_t> const & r) {
-        for(size_t i = r.begin(); i != r.end(); i += r.grainsize()) 
-            acc.Accumulate(a[i]);
-    }
+template<> struct SumInput<double, Vec4d> {
+    static int constexpr block = 8; /**< number of elements consumed per step */
+    double const * a; /**< first element of a real vector to sum */
+    int64_t inc; /**< increment between elements */
+
+    SumInput(double const * a, int64_t inc) : a(a), inc(inc) {}
 
-    /** 
-     * Construction that uses another object of TBBlongsum for initialization
-     * \param x a TBBlongsum instance
-     */
-    TBBlongsum(TBBlongsum & x, tbb::split) : a(x.a), acc(e_bits, f_bits) {}
-
-    /** 
-     * Joins two superaccumulators of two different instances
-     * \param y a TBBlongsum instance
-     */
-    void join(TBBlongsum & y) { acc.Accumulate(y.acc); }
-
-    /** 
-     * Construction that initiates a real vector to sum and a supperacccumulator
-     * \param a a real vector
-     */
-    TBBlongsum(double a[]) :
-        a(a), acc(e_bits, f_bits)
-    {}
+    template<typename CACHE>
+    void Accumulate(CACHE & cache, int64_t i) const {
+        double const * p = a + i * inc;
+        cache.Accumulate(ExLoad(p, inc), ExLoad(p + 4 * inc, inc));
+    }
+    template<typename CACHE>
+    void AccumulateTail(CACHE & cache, int64_t i, int n) const {
+        double const * p = a + i * inc;
+        if (n > 4)
+            cache.Accumulate(ExLoad(p, inc), ExLoadPartial(p + 4 * inc, inc, n - 4));
+        else
+            cache.Accumulate(ExLoadPartial(p, inc, n), Vec4d(0.));
+    }
+    void Accumulate(Superaccumulator & acc, int64_t i) const {
+        acc.Accumulate(a[i * inc]);
+    }
+    void Prefetch(int64_t i, int dist) const {
+        _mm_prefetch((char const*)(a + i * inc) + dist, _MM_HINT_T0);
+    }
+    ptrdiff_t Stride() const { return inc * sizeof(*a); }
 };
 
+/**
+ * \ingroup ExSUM
+ * \brief Single-precision elements widened exactly to double and accumulated with Vec4d expansions
+ */
+template<> struct SumInput<float, Vec4d> {
+    static int constexpr block = 8; /**< number of elements consumed per step */
+    float const * a; /**< first element of a real vector to sum */
+    int64_t inc; /**< increment between elements */
+
+    SumInput(float const * a, int64_t inc) : a(a), inc(inc) {}
+
+    template<typename CACHE>
+    void Accumulate(CACHE & cache, int64_t i) const {
+        Vec8f x = ExLoad(a + i * inc, inc);
+        cache.Accumulate(extend_low(x), extend_high(x));
+    }
+    template<typename CACHE>
+    void AccumulateTail(CACHE & cache, int64_t i, int n) const {
+        Vec8f x = ExLoadPartial(a + i * inc, inc, n);
+        cache.Accumulate(extend_low(x), extend_high(x));
+    }
+    void Accumulate(Superaccumulator & acc, int64_t i) const {
+        acc.Accumulate(double(a[i * inc]));
+    }
+    void Prefetch(int64_t i, int dist) const {
+        _mm_prefetch((char const*)(a + i * inc) + dist, _MM_HINT_T0);
+    }
+    ptrdiff_t Stride() const { return inc * sizeof(*a); }
+};
 
 /**
  * \ingroup ExSUM
- * \brief Parallel summation computes the sum of elements of a real vector with our 
- *     multi-level reproducible and accurate algorithm that solely relies upon superaccumulators
- *
- * \param N vector size
- * \param a vector
- * \param inca specifies the increment for the elements of a
- * \param offset specifies position in the vector to start with 
- * TODO: not done for offset
- * \return Contains the reproducible and accurate sum of elements of a real vector
+ * \brief Single-precision elements accumulated with Vec8f expansions
  */
-double ExSUMSuperacc(int N, double *a, int inca, int offset);
+template<> struct SumInput<float, Vec8f> {
+    static int constexpr block = 16; /**< number of elements consumed per step */
+    float const * a; /**< first element of a real vector to sum */
+    int64_t inc; /**< increment between elements */
+
+    SumInput(float const * a, int64_t inc) : a(a), inc(inc) {}
+
+    template<typename CACHE>
+    void Accumulate(CACHE & cache, int64_t i) const {
+        float const * p = a + i * inc;
+        cache.Accumulate(ExLoad(p, inc), ExLoad(p + 8 * inc, inc));
+    }
+    template<typename CACHE>
+    void AccumulateTail(CACHE & cache, int64_t i, int n) const {
+        float const * p = a + i * inc;
+        if (n > 8)
+            cache.Accumulate(ExLoad(p, inc), ExLoadPartial(p + 8 * inc, inc, n - 8));
+        else
+            cache.Accumulate(ExLoadPartial(p, inc, n), Vec8f(0.f));
+    }
+    void Accumulate(Superaccumulator & acc, int64_t i) const {
+        acc.Accumulate(double(a[i * inc]));
+    }
+    void Prefetch(int64_t i, int dist) const {
+        _mm_prefetch((char const*)(a + i * inc) + dist, _MM_HINT_T0);
+    }
+    ptrdiff_t Stride() const { return inc * sizeof(*a); }
+};
 
 /**
  * \ingroup ExSUM
- * \brief Parallel summation computes the sum of elements of a real vector with our 
- *     multi-level reproducible and accurate algorithm that relies upon 
- *     floating-point expansions of size CACHE and superaccumulators when needed
+ * \brief Returns the elements to sum of the vector of Ng elements with increment inca stored
+ *     from ag + offset. With MPI and without transport, the vector of the root is scattered among
+ *     the processes of MPI_COMM_WORLD, and each of them sums its own contiguous part
  *
- * \param N vector size
- * \param a vector
+ * \param ctx execution context
+ * \param Ng global vector size
+ * \param ag global vector
  * \param inca specifies the increment for the elements of a
- * \param offset specifies position in the vector to start with 
- * TODO: not done for inca and offset
- * \return Contains the reproducible and accurate sum of elements of a real vector
+ * \param offset specifies position in the vector to start with
+ * \param N number of elements to sum on the calling process (output)
  */
-template<typename CACHE> double ExSUMFPE(int N, double *a, int inca, int offset);
+template<typename V, typename T>
+inline SumInput<T, V> ExSumInput(ExContext & ctx, int Ng, T *ag, int inca, int offset, int & N)
+{
+    N = Ng;
+#ifdef EXBLAS_MPI
+    // Participants of a transport already hold their own part of the input
+    if (!ctx.transport) {
+        T *a;
+        N = ExScatter(ctx.scattered[0], Ng, ag, inca, offset, a);
+        // The local parts are contiguous
+        return SumInput<T, V>(a, 1);
+    }
+#endif
+    // The order of the elements does not matter to the sum, so negative increments are reversed
+    return SumInput<T, V>(ag + offset, std::abs(inca));
+}
 
 #endif // EXSUM_HPP_
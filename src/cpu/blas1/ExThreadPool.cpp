@@ -0,0 +1,378 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef EXBLAS_OPENMP
+    #include <omp.h>
+#endif
+#ifdef EXBLAS_TBB
+    #include <tbb/task_arena.h>
+    #include <tbb/parallel_for.h>
+    #include <tbb/partitioner.h>
+#endif
+
+#include "ExThreadPool.hpp"
+
+
+// Whether the calling thread runs a body of the pool
+static thread_local bool inside = false;
+
+/**
+ * \brief Marks the calling thread as running a body of the pool during its lifetime
+ */
+struct ExInside {
+    bool saved;
+    ExInside() : saved(inside) { inside = true; }
+    ~ExInside() { inside = saved; }
+};
+
+bool ExThreadPool::InParallel() const
+{
+#ifdef EXBLAS_OPENMP
+    return inside || omp_in_parallel();
+#else
+    return inside;
+#endif
+}
+
+static int HardwareThreads()
+{
+    int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+/**
+ * \brief Persistent workers, started by the backends. The calling thread runs tid 0 of the
+ *  parallel regions, worker w runs the tids w, w + nworkers, ..., and the workers run the
+ *  queued tasks when no region is open
+ */
+class ExWorkerPool : public ExThreadPool {
+public:
+    ExWorkerPool() : nworkers(0), generation(0), pending(0), stop(false), tnum(0), stride(0), body(0) {}
+
+    void Parallel(int n, std::function<void(int, int)> const & f) {
+        if (inside) {
+            // The workers may all be busy with the enclosing call: run the bodies here
+            for (int tid = 0; tid != n; ++tid)
+                f(tid, n);
+            return;
+        }
+        // One parallel call at a time
+        std::lock_guard<std::mutex> call(call_mutex);
+        Start(n - 1);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            tnum = n;
+            stride = nworkers;
+            body = &f;
+            pending = std::min(n - 1, nworkers);
+            ++generation;
+        }
+        start.notify_all();
+        {
+            ExInside guard;
+            f(0, n);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        body = 0;
+    }
+    void Enqueue(std::function<void()> task) {
+        // Tasks need at least one worker besides the calling thread
+        Start(std::max(HardwareThreads() - 1, 1));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        start.notify_one();
+    }
+    bool StableThreads() const { return true; }
+
+protected:
+    /**
+     * Starts workers until n of them run, as far as the backend allows
+     */
+    virtual void Start(int n) = 0;
+
+    /**
+     * Loop of worker w, from 1, which has seen the parallel regions up to generation seen
+     */
+    void Work(int w, unsigned long seen) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            start.wait(lock, [&] { return stop || (generation != seen) || !tasks.empty(); });
+            if (stop)
+                return;
+            if (generation == seen) {
+                std::function<void()> task = std::move(tasks.front());
+                tasks.pop_front();
+                lock.unlock();
+                {
+                    ExInside guard;
+                    task();
+                }
+                lock.lock();
+                continue;
+            }
+            seen = generation;
+            if (w < tnum) {
+                int n = tnum, step = stride;
+                std::function<void(int, int)> const * f = body;
+                lock.unlock();
+                {
+                    ExInside guard;
+                    for (int tid = w; tid < n; tid += step)
+                        (*f)(tid, n);
+                }
+                lock.lock();
+                if (--pending == 0)
+                    done.notify_one();
+            }
+        }
+    }
+
+    /**
+     * Makes the workers leave their loop
+     */
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        start.notify_all();
+    }
+
+    int nworkers;                   // workers running, protected by mutex
+    std::mutex mutex;
+    unsigned long generation;
+
+private:
+    std::deque<std::function<void()> > tasks;
+    std::mutex call_mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    int pending;
+    bool stop;
+    int tnum;
+    int stride;
+    std::function<void(int, int)> const * body;
+};
+
+/**
+ * \brief Persistent std::thread workers, started as the calls need them
+ */
+class ExStdThreadPool : public ExWorkerPool {
+public:
+    ~ExStdThreadPool() {
+        Stop();
+        for (size_t i = 0; i != workers.size(); ++i)
+            workers[i].join();
+    }
+
+    int MaxThreads() const { return HardwareThreads(); }
+    exblas::Backend GetBackend() const { return exblas::BackendThreads; }
+
+private:
+    void Start(int n) {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (nworkers < n) {
+            workers.push_back(std::thread(&ExStdThreadPool::Work, this, nworkers + 1, generation));
+            ++nworkers;
+        }
+    }
+
+    std::vector<std::thread> workers;
+};
+
+#ifdef EXBLAS_OPENMP
+/**
+ * \brief Threads of the OpenMP runtime. Each parallel call opens a region from the calling
+ *  thread, so that the library holds no team of its own between calls, and the queued tasks
+ *  run on std::thread workers
+ */
+class ExOpenMPPool : public ExStdThreadPool {
+public:
+    void Parallel(int n, std::function<void(int, int)> const & f) {
+        if (inside) {
+            for (int tid = 0; tid != n; ++tid)
+                f(tid, n);
+            return;
+        }
+        // The runtime may form a smaller team than requested
+        #pragma omp parallel num_threads(n)
+        {
+            ExInside guard;
+            int step = omp_get_num_threads();
+            for (int tid = omp_get_thread_num(); tid < n; tid += step)
+                f(tid, n);
+        }
+    }
+    int MaxThreads() const { return omp_get_max_threads(); }
+    exblas::Backend GetBackend() const { return exblas::BackendOpenMP; }
+};
+#endif
+
+#ifdef EXBLAS_TBB
+/**
+ * \brief Workers of the Intel TBB scheduler, within one arena
+ */
+class ExTBBPool : public ExThreadPool {
+public:
+    ExTBBPool() : arena(HardwareThreads()) {}
+
+    void Parallel(int tnum, std::function<void(int, int)> const & body) {
+        arena.execute([&] {
+            tbb::parallel_for(0, tnum, 1, [&](int tid) {
+                ExInside guard;
+                body(tid, tnum);
+            }, tbb::static_partitioner());
+        });
+    }
+    void Enqueue(std::function<void()> task) {
+        arena.enqueue([task] {
+            ExInside guard;
+            task();
+        });
+    }
+    int MaxThreads() const { return HardwareThreads(); }
+    bool StableThreads() const { return false; }
+    exblas::Backend GetBackend() const { return exblas::BackendTBB; }
+
+private:
+    tbb::task_arena arena;
+};
+#endif
+
+
+static std::mutex pool_mutex;
+static exblas::Backend requested = exblas::BackendDefault;
+static ExThreadPool * pool = 0;
+
+// Backend named by the EXBLAS_BACKEND environment variable, or the first one compiled in
+static exblas::Backend DefaultBackend()
+{
+    char const * env = getenv("EXBLAS_BACKEND");
+    if (env) {
+        if (!strcmp(env, "openmp"))
+            return exblas::BackendOpenMP;
+        if (!strcmp(env, "tbb"))
+            return exblas::BackendTBB;
+        if (!strcmp(env, "threads"))
+            return exblas::BackendThreads;
+        fprintf(stderr, "Unknown EXBLAS_BACKEND %s, expected openmp, tbb, or threads\n", env);
+    }
+#if defined(EXBLAS_OPENMP)
+    return exblas::BackendOpenMP;
+#elif defined(EXBLAS_TBB)
+    return exblas::BackendTBB;
+#else
+    return exblas::BackendThreads;
+#endif
+}
+
+static bool Available(exblas::Backend backend)
+{
+    switch (backend) {
+#ifdef EXBLAS_OPENMP
+        case exblas::BackendOpenMP: return true;
+#endif
+#ifdef EXBLAS_TBB
+        case exblas::BackendTBB: return true;
+#endif
+        case exblas::BackendThreads: return true;
+        default: return false;
+    }
+}
+
+ExThreadPool & ExPool()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (!pool) {
+        exblas::Backend backend = (requested == exblas::BackendDefault) ? DefaultBackend() : requested;
+        if (!Available(backend)) {
+            fprintf(stderr, "The requested threading backend is not compiled in, using the default one\n");
+            backend = DefaultBackend();
+            if (!Available(backend))
+                backend = exblas::BackendThreads;
+        }
+        switch (backend) {
+#ifdef EXBLAS_OPENMP
+            case exblas::BackendOpenMP: pool = new ExOpenMPPool(); break;
+#endif
+#ifdef EXBLAS_TBB
+            case exblas::BackendTBB: pool = new ExTBBPool(); break;
+#endif
+            default: pool = new ExStdThreadPool(); break;
+        }
+    }
+    return *pool;
+}
+
+bool exblas::set_backend(Backend backend)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (pool)
+        return pool->GetBackend() == backend;
+    if ((backend != BackendDefault) && !Available(backend))
+        return false;
+    requested = backend;
+    return true;
+}
+
+exblas::Backend exblas::get_backend()
+{
+    return ExPool().GetBackend();
+}
+
+
+ExHelperThread::~ExHelperThread()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    queued.notify_one();
+    thread.join();
+}
+
+void ExHelperThread::Run(std::function<void()> f)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = std::move(f);
+        busy = true;
+        if (!thread.joinable())
+            thread = std::thread(&ExHelperThread::Loop, this);
+    }
+    queued.notify_one();
+}
+
+void ExHelperThread::Loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        queued.wait(lock, [this] { return stop || busy; });
+        if (busy) {
+            std::function<void()> f = std::move(job);
+            busy = false;
+            lock.unlock();
+            f();
+            lock.lock();
+        } else {
+            return;
+        }
+    }
+}
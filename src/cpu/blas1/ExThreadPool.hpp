@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExThreadPool.hpp
+ *  \brief Provides the threading backends (OpenMP, Intel TBB, std::thread) behind
+ *         a common interface. For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXTHREADPOOL_HPP_
+#define EXTHREADPOOL_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "context.hpp"
+
+/**
+ * \class ExThreadPool
+ * \ingroup context
+ * \brief Interface of the threading backends. A single pool exists in the process,
+ *  shared by all the contexts
+ */
+class ExThreadPool {
+public:
+    virtual ~ExThreadPool() {}
+
+    /**
+     * Runs body(tid, tnum) for tid in [0, tnum), in parallel as far as the backend allows.
+     * The bodies must not wait for each other, since they may run one after another
+     * \param tnum number of parallel tasks
+     * \param body function to run
+     */
+    virtual void Parallel(int tnum, std::function<void(int, int)> const & body) = 0;
+
+    /**
+     * Runs task asynchronously on a thread of the pool. The tasks of several callers
+     * share the threads instead of each claiming all of them
+     * \param task function to run
+     */
+    virtual void Enqueue(std::function<void()> task) = 0;
+
+    /**
+     * Returns whether the calling thread runs within a parallel region, either one of
+     * the pool or, with OpenMP, one opened by the user
+     */
+    bool InParallel() const;
+
+    /**
+     * Returns the default number of threads
+     */
+    virtual int MaxThreads() const = 0;
+
+    /**
+     * Returns whether the body with a given tid runs on the same thread from one
+     * call to another, which is needed to bind threads to NUMA nodes
+     */
+    virtual bool StableThreads() const = 0;
+
+    /**
+     * Returns the backend of the pool
+     */
+    virtual exblas::Backend GetBackend() const = 0;
+};
+
+/**
+ * \ingroup context
+ * \brief Returns the thread pool of the process, creating it with the selected backend at the first call
+ */
+ExThreadPool & ExPool();
+
+/**
+ * \class ExHelperThread
+ * \ingroup context
+ * \brief Thread of a context running one job at a time beside the calling thread, such as the
+ *  accumulation of the batches of a pipeline. It is started at the first job and joined with the context
+ */
+class ExHelperThread {
+public:
+    ExHelperThread() : busy(false), stop(false) {}
+    ~ExHelperThread();
+
+    /**
+     * Starts job on the thread. The caller waits for the completion of the job, signaled by the
+     * job itself, before starting the next one
+     * \param job function to run
+     */
+    void Run(std::function<void()> job);
+
+private:
+    ExHelperThread(ExHelperThread const &) = delete;
+    ExHelperThread & operator=(ExHelperThread const &) = delete;
+
+    void Loop();
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::function<void()> job; /**< next job, protected by mutex */
+    bool busy; /**< whether job is set, protected by mutex */
+    bool stop; /**< whether the thread should leave its loop, protected by mutex */
+};
+
+#endif // EXTHREADPOOL_HPP_
@@ -0,0 +1,553 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <immintrin.h>
+
+#include "transport.hpp"
+#include "common.hpp"
+#include "superaccumulator.hpp"
+#include "ExTransport.hpp"
+
+
+void exblas::Transport::reduce(int64_t * acc, int words, int count)
+{
+    allreduce(acc, words, count);
+}
+
+void exblas::Transport::reduce_scatter(int64_t * acc, int words, int const * counts)
+{
+    int first = 0, count = 0;
+    for (int r = 0; r != get_size(); ++r) {
+        if (r == get_rank())
+            first = count;
+        count += counts[r];
+    }
+    allreduce(acc, words, count);
+    std::copy(acc + int64_t(first) * words, acc + int64_t(first + counts[get_rank()]) * words, acc);
+}
+
+exblas::Transport::Pending * exblas::Transport::iallreduce(int64_t * acc, int words)
+{
+    allreduce(acc, words, 1);
+    return 0;
+}
+
+bool exblas::Transport::concurrent() const
+{
+    return true;
+}
+
+
+// Number of superaccumulators merged at once by the groups sharing memory; more are merged in several rounds
+static int const ExSharedEntries = 8;
+
+// Words of the largest superaccumulator of the routines
+static int ExSharedWords()
+{
+    static int const words = Superaccumulator(e_bits, f_bits).get_f_words() + Superaccumulator(e_bits, f_bits).get_e_words();
+    return words;
+}
+
+// Start of the memory shared by the participants of a group, followed by three regions
+// of ExSharedEntries superaccumulators. It is valid once filled with zeros
+struct ExSharedHeader {
+    int32_t arrived;    // participants having reached the current barrier
+    int32_t generation; // barriers completed so far
+    int32_t owner;      // process of rank 0 with SharedTransport, set once the segment is sized
+    char padding[52];   // keeps the regions off the cache line of the counters
+};
+
+// Waits for all the size participants of the group; the last one to arrive releases the others
+static void ExSharedBarrier(ExSharedHeader * h, int size)
+{
+    int32_t generation = __atomic_load_n(&h->generation, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&h->arrived, 1, __ATOMIC_ACQ_REL) == size) {
+        __atomic_store_n(&h->arrived, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&h->generation, generation + 1, __ATOMIC_RELEASE);
+        return;
+    }
+    for (int spins = 0; __atomic_load_n(&h->generation, __ATOMIC_ACQUIRE) == generation; ++spins) {
+        // Participants may outnumber the cores
+        if (spins < 1000)
+            _mm_pause();
+        else
+            sched_yield();
+    }
+}
+
+/*
+ * Merges count superaccumulators of words words in acc with the ones of the other participants.
+ * Each call adds into one of the three regions in turn, atomically, then reads it back after a barrier.
+ * Rank 0 clears the region of the next call beforehand: it was last read two calls ago, before the
+ * barrier of the previous call, and the next call adds into it only after the barrier of this one
+ */
+static void ExSharedAllreduce(ExSharedHeader * h, int rank, int size, int64_t & calls, int64_t * acc, int words, int count)
+{
+    int capacity = ExSharedWords() * ExSharedEntries;
+    if (words > ExSharedWords()) {
+        fprintf(stderr, "Superaccumulators of %d words do not fit the shared regions\n", words);
+        exit(1);
+    }
+    if (size == 1)
+        return;
+    int64_t * regions = (int64_t *)(h + 1);
+    int per = capacity / words;
+    for (int first = 0; first < count; first += per) {
+        int n = std::min(per, count - first);
+        int64_t * sum = regions + (calls % 3) * capacity;
+        if (rank == 0) {
+            int64_t * next = regions + ((calls + 1) % 3) * capacity;
+            std::fill(next, next + capacity, 0);
+        }
+        for (int k = 0; k != n; ++k)
+            Superaccumulator::AccumulateWordsAtomic(sum + k * words, acc + int64_t(first + k) * words, words);
+        ExSharedBarrier(h, size);
+        std::copy(sum, sum + n * words, acc + int64_t(first) * words);
+        ++calls;
+    }
+}
+
+/*
+ * Gathers the blocks of counts[r] words of the participants r in values, through the same regions as
+ * ExSharedAllreduce. Each round, up to capacity / size words of each block are copied into the part of the
+ * participant in a region, read back by the others after a barrier. Larger groups are gathered in turns
+ */
+static void ExSharedAllgather(ExSharedHeader * h, int rank, int size, int64_t & calls, int64_t * values, int const * counts)
+{
+    if (size == 1)
+        return;
+    int capacity = ExSharedWords() * ExSharedEntries;
+    int64_t * regions = (int64_t *)(h + 1);
+    std::vector<int64_t> first(size + 1, 0);
+    for (int r = 0; r != size; ++r)
+        first[r + 1] = first[r] + counts[r];
+    int most = *std::max_element(counts, counts + size);
+    int turn = std::min(size, capacity);
+    int per = capacity / turn;
+    for (int base = 0; base < size; base += turn) {
+        for (int done = 0; done < most; done += per) {
+            int64_t * parts = regions + (calls % 3) * capacity;
+            if (rank == 0) {
+                int64_t * next = regions + ((calls + 1) % 3) * capacity;
+                std::fill(next, next + capacity, 0);
+            }
+            if ((rank >= base) && (rank < base + turn)) {
+                int n = std::max(0, std::min(per, counts[rank] - done));
+                std::copy(values + first[rank] + done, values + first[rank] + done + n, parts + (rank - base) * per);
+            }
+            ExSharedBarrier(h, size);
+            for (int r = base; (r != size) && (r != base + turn); ++r) {
+                int n = std::max(0, std::min(per, counts[r] - done));
+                if (r != rank)
+                    std::copy(parts + (r - base) * per, parts + (r - base) * per + n, values + first[r] + done);
+            }
+            ++calls;
+        }
+    }
+}
+
+// Bytes of the memory shared by a group
+static size_t ExSharedBytes()
+{
+    return sizeof(ExSharedHeader) + 3 * ExSharedWords() * ExSharedEntries * sizeof(int64_t);
+}
+
+
+/**
+ * \struct exblas::LoopbackTransport::Impl
+ * \ingroup transport
+ * \brief Participant of a group within the process, sharing its memory with the others
+ */
+struct exblas::LoopbackTransport::Impl {
+    std::shared_ptr<std::vector<int64_t> > shared; /**< memory of the group, freed with its last participant */
+    int rank; /**< position of the participant */
+    int size; /**< number of participants */
+    int64_t calls; /**< merges done so far */
+
+    ExSharedHeader * Header() { return (ExSharedHeader *)&(*shared)[0]; }
+};
+
+exblas::LoopbackTransport::LoopbackTransport(int size) :
+    pimpl(new Impl)
+{
+    pimpl->shared = std::make_shared<std::vector<int64_t> >(ExSharedBytes() / sizeof(int64_t), 0);
+    pimpl->rank = 0;
+    pimpl->size = size;
+    pimpl->calls = 0;
+}
+
+exblas::LoopbackTransport::LoopbackTransport(LoopbackTransport const & other, int rank) :
+    pimpl(new Impl(*other.pimpl))
+{
+    pimpl->rank = rank;
+    pimpl->calls = 0;
+}
+
+exblas::LoopbackTransport::~LoopbackTransport()
+{
+    delete pimpl;
+}
+
+int exblas::LoopbackTransport::get_rank() const
+{
+    return pimpl->rank;
+}
+
+int exblas::LoopbackTransport::get_size() const
+{
+    return pimpl->size;
+}
+
+void exblas::LoopbackTransport::allreduce(int64_t * acc, int words, int count)
+{
+    ExSharedAllreduce(pimpl->Header(), pimpl->rank, pimpl->size, pimpl->calls, acc, words, count);
+}
+
+void exblas::LoopbackTransport::allgather(int64_t * values, int const * counts)
+{
+    ExSharedAllgather(pimpl->Header(), pimpl->rank, pimpl->size, pimpl->calls, values, counts);
+}
+
+
+// Whether the process that created the segment still runs, i.e. the segment is not left
+// over by a group whose rank 0 ended before all the participants attached
+static bool ExSharedLive(ExSharedHeader * h)
+{
+    pid_t owner = __atomic_load_n(&h->owner, __ATOMIC_ACQUIRE);
+    return (owner != 0) && ((kill(owner, 0) == 0) || (errno == EPERM));
+}
+
+// Maps the segment open on fd, or returns null
+static ExSharedHeader * ExSharedMap(int fd, size_t bytes)
+{
+    void * base = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return (base == MAP_FAILED) ? 0 : (ExSharedHeader *)base;
+}
+
+// Creates the segment of rank 0, replacing one left over by an earlier group, and returns its
+// descriptor, or -1 when it cannot be created or a running group uses the same name
+static int ExSharedCreate(char const * name, size_t bytes)
+{
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if ((fd < 0) && (errno == EEXIST)) {
+        int old = shm_open(name, O_RDWR, 0600);
+        struct stat st;
+        bool live = false;
+        if ((old >= 0) && (fstat(old, &st) == 0) && (size_t(st.st_size) >= bytes)) {
+            ExSharedHeader * h = ExSharedMap(old, bytes);
+            live = h && ExSharedLive(h);
+            if (h)
+                munmap(h, bytes);
+        }
+        if (old >= 0)
+            close(old);
+        if (live)
+            return -1;
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if ((fd >= 0) && (ftruncate(fd, bytes) != 0)) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * \struct exblas::SharedTransport::Impl
+ * \ingroup transport
+ * \brief Participant of a group of processes, with its mapping of the shared-memory segment
+ */
+struct exblas::SharedTransport::Impl {
+    ExSharedHeader * header; /**< mapping of the segment */
+    int rank; /**< position of the participant */
+    int size; /**< number of participants */
+    int64_t calls; /**< merges done so far */
+};
+
+exblas::SharedTransport::SharedTransport(char const * name, int rank, int size) :
+    pimpl(new Impl)
+{
+    size_t bytes = ExSharedBytes();
+    pimpl->header = 0;
+    pimpl->rank = rank;
+    pimpl->size = size;
+    pimpl->calls = 0;
+
+    ExSharedHeader * h = 0;
+    if (rank == 0) {
+        // A new segment is filled with zeros; it is valid for the others once it names its owner
+        int fd = ExSharedCreate(name, bytes);
+        if (fd < 0) {
+            fprintf(stderr, "Cannot create the shared-memory segment %s\n", name);
+            return;
+        }
+        h = ExSharedMap(fd, bytes);
+        close(fd);
+        if (!h) {
+            shm_unlink(name);
+            fprintf(stderr, "Cannot map the shared-memory segment %s\n", name);
+            return;
+        }
+        __atomic_store_n(&h->owner, int32_t(getpid()), __ATOMIC_RELEASE);
+    } else {
+        // Waits for rank 0 to create and size the segment, skipping one left over by an earlier group
+        for (;;) {
+            struct stat st;
+            int fd = shm_open(name, O_RDWR, 0600);
+            if ((fd >= 0) && (fstat(fd, &st) == 0) && (size_t(st.st_size) >= bytes)) {
+                h = ExSharedMap(fd, bytes);
+                close(fd);
+                if (!h) {
+                    fprintf(stderr, "Cannot map the shared-memory segment %s\n", name);
+                    return;
+                }
+                if (ExSharedLive(h))
+                    break;
+                munmap(h, bytes);
+            } else if (fd >= 0) {
+                close(fd);
+            }
+            usleep(1000);
+        }
+    }
+    pimpl->header = h;
+
+    // The mappings keep the segment once all the participants are attached
+    ExSharedBarrier(pimpl->header, size);
+    if (rank == 0)
+        shm_unlink(name);
+}
+
+exblas::SharedTransport::~SharedTransport()
+{
+    if (pimpl->header)
+        munmap(pimpl->header, ExSharedBytes());
+    delete pimpl;
+}
+
+bool exblas::SharedTransport::is_open() const
+{
+    return pimpl->header != 0;
+}
+
+int exblas::SharedTransport::get_rank() const
+{
+    return pimpl->rank;
+}
+
+int exblas::SharedTransport::get_size() const
+{
+    return pimpl->size;
+}
+
+void exblas::SharedTransport::allreduce(int64_t * acc, int words, int count)
+{
+    ExSharedAllreduce(pimpl->header, pimpl->rank, pimpl->size, pimpl->calls, acc, words, count);
+}
+
+void exblas::SharedTransport::allgather(int64_t * values, int const * counts)
+{
+    ExSharedAllgather(pimpl->header, pimpl->rank, pimpl->size, pimpl->calls, values, counts);
+}
+
+
+exblas::Request::Impl::Impl(Superaccumulator const & acc) :
+    acc(acc),
+    pending(0),
+    done(false),
+    result(0.)
+{
+}
+
+exblas::Request::Impl::~Impl()
+{
+    delete pending;
+}
+
+void exblas::Request::Impl::Complete()
+{
+    delete pending;
+    pending = 0;
+    acc.set_accumulator(words);
+    result = acc.Round();
+    done = true;
+}
+
+exblas::Request ExIallreduce(Superaccumulator & acc, exblas::Transport & transport)
+{
+    acc.Normalize();
+    exblas::Request::Impl * impl = new exblas::Request::Impl(acc);
+    impl->words = acc.get_accumulator();
+    impl->pending = transport.iallreduce(&impl->words[0], impl->words.size());
+    return exblas::Request(impl);
+}
+
+exblas::Request::Request() :
+    pimpl(0)
+{
+}
+
+exblas::Request::Request(Impl * impl) :
+    pimpl(impl)
+{
+}
+
+exblas::Request::Request(Request && other) :
+    pimpl(other.pimpl)
+{
+    other.pimpl = 0;
+}
+
+exblas::Request & exblas::Request::operator=(Request && other)
+{
+    if (this != &other) {
+        // The buffers of a pending merge are freed only once it completes
+        wait();
+        delete pimpl;
+        pimpl = other.pimpl;
+        other.pimpl = 0;
+    }
+    return *this;
+}
+
+exblas::Request::~Request()
+{
+    wait();
+    delete pimpl;
+}
+
+bool exblas::Request::test()
+{
+    if (!pimpl || pimpl->done)
+        return true;
+    if (pimpl->pending && !pimpl->pending->test())
+        return false;
+    pimpl->Complete();
+    return true;
+}
+
+double exblas::Request::wait()
+{
+    if (!pimpl)
+        return 0.;
+    if (!pimpl->done) {
+        if (pimpl->pending)
+            pimpl->pending->wait();
+        pimpl->Complete();
+    }
+    return pimpl->result;
+}
+
+void ExAllreduceBatch(std::vector<Superaccumulator> & accs, exblas::Transport & transport, double * results)
+{
+    // The transports take the number of superaccumulators as an int
+    int64_t count = accs.size();
+    if (count == 0)
+        return;
+    if (count > INT_MAX) {
+        fprintf(stderr, "Cannot merge more than %d superaccumulators at once\n", INT_MAX);
+        return;
+    }
+    int words = accs[0].get_f_words() + accs[0].get_e_words();
+    std::vector<int64_t> all(count * words);
+    for (int64_t k = 0; k != count; ++k) {
+        accs[k].Normalize();
+        std::vector<int64_t> w = accs[k].get_accumulator();
+        std::copy(w.begin(), w.end(), &all[k * words]);
+    }
+    transport.allreduce(&all[0], words, int(count));
+    for (int64_t k = 0; k != count; ++k) {
+        accs[k].set_accumulator(std::vector<int64_t>(&all[k * words], &all[k * words] + words));
+        results[k] = accs[k].Round();
+    }
+}
+
+void ExReduceScatterBatch(std::vector<Superaccumulator> & accs, exblas::Transport & transport, int const * counts, double * results)
+{
+    int64_t count = accs.size();
+    if (count == 0)
+        return;
+    int rank = transport.get_rank();
+    int64_t first = 0;
+    for (int r = 0; r != rank; ++r)
+        first += counts[r];
+    int words = accs[0].get_f_words() + accs[0].get_e_words();
+    std::vector<int64_t> all(count * words);
+    for (int64_t k = 0; k != count; ++k) {
+        accs[k].Normalize();
+        std::vector<int64_t> w = accs[k].get_accumulator();
+        std::copy(w.begin(), w.end(), &all[k * words]);
+    }
+    transport.reduce_scatter(&all[0], words, counts);
+    for (int64_t k = 0; k != counts[rank]; ++k) {
+        Superaccumulator & acc = accs[first + k];
+        acc.set_accumulator(std::vector<int64_t>(&all[k * words], &all[k * words] + words));
+        results[first + k] = acc.Round();
+    }
+}
+
+void ExPipelineBatches(ExHelperThread & helper, int steps, int count, exblas::Transport & transport, double * results,
+    std::function<void(int, std::vector<Superaccumulator> &)> const & accumulate)
+{
+    // Batch k is accumulated into buffer k % 2, once batch k - 2 has been merged from it
+    std::vector<Superaccumulator> accs[2];
+    if ((steps < 2) || !transport.concurrent()) {
+        for (int k = 0; k != steps; ++k) {
+            accumulate(k, accs[0]);
+            ExAllreduceBatch(accs[0], transport, results + int64_t(k) * count);
+        }
+        return;
+    }
+
+    std::mutex lock;
+    std::condition_variable changed;
+    int accumulated = 0, reduced = 0;
+    bool finished = false;
+    helper.Run([&]() {
+        for (int k = 0; k != steps; ++k) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [&]() { return reduced >= k - 1; });
+            }
+            accumulate(k, accs[k % 2]);
+            std::lock_guard<std::mutex> guard(lock);
+            accumulated = k + 1;
+            changed.notify_all();
+        }
+        // Last access to the state of the caller, which returns once it is seen
+        std::lock_guard<std::mutex> guard(lock);
+        finished = true;
+        changed.notify_all();
+    });
+    for (int k = 0; k != steps; ++k) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&]() { return accumulated > k; });
+        }
+        ExAllreduceBatch(accs[k % 2], transport, results + int64_t(k) * count);
+        std::lock_guard<std::mutex> guard(lock);
+        reduced = k + 1;
+        changed.notify_all();
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [&]() { return finished; });
+}
@@ -0,0 +1,124 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/**
+ *  \file cpu/blas1/ExTransport.hpp
+ *  \brief Provides the non-blocking, batched and pipelined merges of superaccumulators
+ *         among the participants of a transport. For internal use
+ *
+ *  \authors
+ *    Developers : \n
+ *        Roman Iakymchuk  -- roman.iakymchuk@lip6.fr \n
+ *        Sylvain Collange -- sylvain.collange@inria.fr \n
+ */
+
+#ifndef EXTRANSPORT_HPP_
+#define EXTRANSPORT_HPP_
+
+#include <functional>
+#include <vector>
+#include "blas1.hpp"
+#include "transport.hpp"
+#include "superaccumulator.hpp"
+#include "ExThreadPool.hpp"
+
+/**
+ * \struct exblas::Request::Impl
+ * \ingroup ExSUM
+ * \brief Non-blocking merge of superaccumulators in flight, with its buffer
+ */
+struct exblas::Request::Impl {
+    Superaccumulator acc; /**< range of the result, then the merged superaccumulator */
+    std::vector<int64_t> words; /**< normalized superaccumulator of the caller, replaced by the merged one */
+    exblas::Transport::Pending * pending; /**< merge in flight, or null once it has completed */
+    bool done; /**< whether the merge has completed and result is set */
+    double result; /**< rounded result once done */
+
+    /**
+     * Construction
+     * \param acc normalized superaccumulator of the caller
+     */
+    Impl(Superaccumulator const & acc);
+
+    ~Impl();
+
+    /**
+     * Rounds the merged superaccumulator once the merge has completed
+     */
+    void Complete();
+};
+
+/**
+ * \ingroup ExSUM
+ * \brief Merges the superaccumulators of the participants of transport onto its participant 0,
+ *     or onto all of them
+ *
+ * \param acc superaccumulator of the caller, receiving the result
+ * \param transport participants
+ * \param all whether every participant receives the result
+ * \param scratch buffer of the words, reused from one call to another
+ */
+inline void ExMerge(Superaccumulator & acc, exblas::Transport & transport, bool all, std::vector<int64_t> & scratch)
+{
+    acc.Normalize();
+    scratch = acc.get_accumulator();
+    if (all)
+        transport.allreduce(&scratch[0], scratch.size(), 1);
+    else
+        transport.reduce(&scratch[0], scratch.size(), 1);
+    acc.set_accumulator(scratch);
+}
+
+/**
+ * \ingroup ExSUM
+ * \brief Starts merging the superaccumulators of the participants of transport onto all of them
+ *
+ * \param acc superaccumulator of the caller, copied before returning
+ * \param transport participants
+ * \return Handle on the pending merge
+ */
+exblas::Request ExIallreduce(Superaccumulator & acc, exblas::Transport & transport);
+
+/**
+ * \ingroup ExSUM
+ * \brief Merges several superaccumulators of the participants of transport onto all of them
+ *     in a single call of Transport::allreduce, such as a single message with MPI
+ *
+ * \param accs superaccumulators of the caller
+ * \param transport participants
+ * \param results reproducible and accurate results, one per superaccumulator
+ */
+void ExAllreduceBatch(std::vector<Superaccumulator> & accs, exblas::Transport & transport, double * results);
+
+/**
+ * \ingroup ExSUM
+ * \brief Merges several superaccumulators of the participants of transport, split in blocks of counts[r]
+ *     superaccumulators: participant r receives and rounds the ones of block r only, with Transport::reduce_scatter
+ *
+ * \param accs superaccumulators of the caller, the ones of all the blocks one after another
+ * \param transport participants
+ * \param counts number of superaccumulators of the block of each participant
+ * \param results reproducible and accurate results, one per superaccumulator, set for the block of the caller only
+ */
+void ExReduceScatterBatch(std::vector<Superaccumulator> & accs, exblas::Transport & transport, int const * counts, double * results);
+
+/**
+ * \ingroup ExSUM
+ * \brief Accumulates and merges steps batches of count superaccumulators in turn, as ExAllreduceBatch.
+ *     When the transport may merge while the routines run, see Transport::concurrent, the helper
+ *     thread of the context accumulates batch k+1 while the calling thread merges batch k.
+ *     Otherwise, each batch is merged once accumulated
+ *
+ * \param helper helper thread of the context of the call
+ * \param steps number of batches
+ * \param count number of superaccumulators per batch
+ * \param transport participants
+ * \param results reproducible and accurate results, count per batch
+ * \param accumulate fills its vector with the count normalized superaccumulators of the given batch
+ */
+void ExPipelineBatches(ExHelperThread & helper, int steps, int count, exblas::Transport & transport, double * results,
+    std::function<void(int, std::vector<Superaccumulator> &)> const & accumulate);
+
+#endif // EXTRANSPORT_HPP_
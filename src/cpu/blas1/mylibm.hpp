@@ -216,5 +216,48 @@ inline static bool horizontal_or(Vec4d const & a) {
     return !_mm256_testz_pd(p, p);
 }
 
+inline static bool horizontal_or(Vec8f const & a) {
+    Vec8fb p = a != 0;
+    return !_mm256_testz_ps(p, p);
+}
+
+/**
+ * \struct VectorTraits
+ * \brief Scalar type, mask type and number of lanes of the SIMD vectors used in
+ *  floating-point expansions. For internal use
+ */
+template<typename T> struct VectorTraits;
+
+template<> struct VectorTraits<Vec4d> {
+    typedef double scalar;
+    typedef Vec4db mask;
+    static int constexpr lanes = 4;
+};
+
+template<> struct VectorTraits<Vec8f> {
+    typedef float scalar;
+    typedef Vec8fb mask;
+    static int constexpr lanes = 8;
+};
+
+// Rounds th + tl to odd, th, tl >= 0
+// Unlike OddRoundSumNonnegative, it does not require th and tl to be non-overlapping
+inline static double OddRoundSum(double th, double tl)
+{
+    union {
+        double d;
+        int64_t l;
+    } thdb;
+
+    thdb.d = th + tl;
+    double z = thdb.d - th;
+    double err = (th - (thdb.d - z)) + (tl - z);
+    if(err != 0 && !(thdb.l & 1)) {
+        // Move to the odd neighbour in the direction of the exact sum
+        thdb.l += (err > 0) ? 1 : -1;
+    }
+    return thdb.d;
+}
+
 
 #endif
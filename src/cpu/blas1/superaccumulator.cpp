@@ -8,6 +8,8 @@
 #include <ostream>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
+#include <cstdlib>
 
 #include <iostream>
 
@@ -77,13 +79,91 @@ void Superaccumulator::Accumulate(Superaccumulator & other)
     }
 }
 
+void Superaccumulator::MergeWords(int64_t * acc, int64_t const * other, int words)
+{
+    // Normalized words take at most digits + 1 bits, so their sum cannot overflow
+    int64_t carry_in = 0;
+    for(int i = 0; i != words; ++i) {
+        acc[i] += other[i] + carry_in;
+        carry_in = acc[i] >> digits;    // Arithmetic shift
+        acc[i] -= carry_in << digits;
+    }
+    // Do not cancel the last carry to avoid losing information
+    acc[words - 1] += carry_in << digits;
+}
+
+void Superaccumulator::BalanceWords(int64_t * acc, int words)
+{
+    int64_t carry_in = 0;
+    for(int i = 0; i != words; ++i) {
+        acc[i] += carry_in;
+        carry_in = (acc[i] + (1ll << (digits - 1))) >> digits;    // Arithmetic shift
+        acc[i] -= carry_in << digits;
+    }
+    // Do not cancel the last carry to avoid losing information
+    acc[words - 1] += carry_in << digits;
+}
+
+void Superaccumulator::AccumulateWordsAtomic(int64_t * acc, int64_t const * other, int words)
+{
+    for(int j = 0; j != words; ++j) {
+        int64_t x = other[j];
+        for(int i = j; x != 0; ++i) {
+            if(i == words - 1) {
+                __atomic_fetch_add(&acc[i], x, __ATOMIC_RELAXED);
+                break;
+            }
+            // Once half of the carry-save bits are used, the carry moves to the next word. The word is
+            // replaced only if it still holds the value seen, so that each carry is moved once, by the
+            // addition that caused it, and concurrent additions cannot make the word overflow
+            int64_t oldword = __atomic_load_n(&acc[i], __ATOMIC_RELAXED), newword, carry;
+            do {
+                newword = oldword + x;
+                carry = likely(std::abs(newword) < (1ll << (digits + K / 2))) ? 0 : newword >> digits;    // Arithmetic shift
+            } while(!__atomic_compare_exchange_n(&acc[i], &oldword, newword - (carry << digits), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+            x = carry;
+        }
+    }
+}
+
 double Superaccumulator::Round()
+{
+    double hi, lo;
+    bool negative = RoundParts(hi, lo);
+    // Final rounding
+    hi = hi + lo;
+    return negative ? -hi : hi;
+}
+
+float Superaccumulator::RoundFloat()
+{
+    double hi, lo;
+    bool negative = RoundParts(hi, lo);
+    // Round to odd in double first to avoid double rounding, then to nearest in float
+    float rounded = float(OddRoundSum(hi, lo));
+    return negative ? -rounded : rounded;
+}
+
+// Splits the absolute value of the superaccumulator into hi + lo, both exact, whose sum is the value
+// rounded to odd on 62 bits, so that rounding hi + lo once gives the correctly rounded result; returns the sign
+bool Superaccumulator::RoundParts(double & hi, double & lo)
 {
     assert(digits >= 52);
+    hi = lo = 0;
     if(imin > imax) {
-        return 0;
+        return false;
     }
     bool negative = Normalize();
+    if(negative) {
+        // Split the exact opposite, so that the rounding of the absolute value does not
+        // depend on the sign; complementing words one by one loses the borrow of the lower ones
+        Superaccumulator opposite(*this);
+        for(int j = imin; j <= imax; ++j) {
+            opposite.accumulator[j] = -accumulator[j];
+        }
+        opposite.RoundParts(hi, lo);
+        return true;
+    }
     
     // Find leading word
     int i;
@@ -92,45 +172,55 @@ double Superaccumulator::Round()
         accumulator[i] == 0 && i >= imin;
         --i) {
     }
-    if(negative) {
-        // Skip ones
-        for(;
-            (accumulator[i] & ((1ll << digits) - 1)) == ((1ll << digits) - 1) && i >= imin;
-            --i) {
-        }
-    }
     if(i < 0) {
-        return 0.;
+        return false;
     }
     
-    int64_t hiword = negative ? ((1ll << digits) - 1) - accumulator[i] : accumulator[i];
-    double rounded = double(hiword);
-    double hi = ldexp(rounded, (i - f_words) * digits);
-    if(i == 0) {
-        return negative ? -hi : hi;  // Correct rounding achieved
-    }
-    hiword -= llrint(rounded);
-    double mid = ldexp(double(hiword), (i - f_words) * digits);
+    // Gather the leading words until at least 64 bits are known: the value is v 2^(digits (j - f_words))
+    // plus the words below j. A leading word of a few bits leaves no room below the rounding point otherwise
+    int j = i;
+    unsigned __int128 v = accumulator[i];
+    while(j > 0 && (v >> 64) == 0) {
+        --j;
+        v = (v << digits) | uint64_t(accumulator[j]);
+    }
     
     // Compute sticky
     int64_t sticky = 0;
-    for(int j = imin; j != i - 1; ++j) {
-        sticky |= negative ? (1ll << digits) - accumulator[j] : accumulator[j];
+    for(int k = imin; k < j; ++k) {
+        sticky |= accumulator[k];
     }
     
-    int64_t loword = negative ? (1ll << digits) - accumulator[i-1] : accumulator[i-1];
-    loword |=!! sticky;
-    double lo = ldexp(double(loword), (i - 1 - f_words) * digits);
+    // Keep 62 bits, rounded to odd with the sticky bit well below the 53 bits of the result
+    uint64_t top = uint64_t(v >> 64);
+    int bits = top ? 128 - __builtin_clzll(top) : 64 - __builtin_clzll(uint64_t(v));
+    int shift = std::max(bits - 62, 0);
+    uint64_t r = uint64_t(v >> shift);
+    if(shift > 0 && ((v & (((unsigned __int128)1 << shift) - 1)) != 0 || sticky != 0)) {
+        r |= 1;
+    }
     
- 
-    // Now add3(hi, mid, lo)
-    // No overlap, we have already normalized
-    if(mid != 0) {
-        lo = OddRoundSumNonnegative(mid, lo);
+    // Below the smallest normal number, round to the precision of subnormals at once
+    int e = (j - f_words) * digits + shift;
+    if(e + 63 - __builtin_clzll(r) < -1022) {
+        int d = -1074 - e;
+        if(d >= 63) {
+            // Less than half of the smallest subnormal
+            r = 0;
+            e = -1074;
+        } else if(d > 0) {
+            uint64_t rem = r & ((uint64_t(1) << d) - 1);
+            uint64_t half = uint64_t(1) << (d - 1);
+            r >>= d;
+            r += (rem > half) || (rem == half && (r & 1));
+            e = -1074;
+        }
     }
-    // Final rounding
-    hi = hi + lo;
-    return negative ? -hi : hi;
+    
+    // Both parts are exact, so that hi + lo rounds r once
+    hi = ldexp(double(int64_t(r & ~uint64_t(1023))), e);
+    lo = ldexp(double(int64_t(r & 1023)), e);
+    return false;
 }
 
 // Returns sign
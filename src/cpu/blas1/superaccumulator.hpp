@@ -69,6 +69,11 @@ struct Superaccumulator
      * Function to perform correct rounding
      */
     double Round();
+
+    /**
+     * Function to perform correct rounding to single precision
+     */
+    float RoundFloat();
     
     /**< Characterizes the result of summation */
     enum Status
@@ -112,8 +117,37 @@ struct Superaccumulator
      */
     void set_accumulator(std::vector<int64_t> other);
 
+    /**
+     * Function for adding the words of a normalized superaccumulator into the ones of another,
+     * normalizing the result, so that merges can be chained without running out of carry-save bits
+     * \param acc words of the superaccumulator receiving the sum, normalized
+     * \param other words of the superaccumulator to add, normalized
+     * \param words number of words of both, i.e. f_words + e_words
+     */
+    static void MergeWords(int64_t * acc, int64_t const * other, int words);
+
+    /**
+     * Function for rewriting words in place as balanced digits, in [-2^(digits-1), 2^(digits-1)),
+     * so that numbers of small magnitude have few nonzero words whatever their sign. The last carry
+     * is kept in the last word. Normalize accepts balanced words as well as regular ones
+     * \param acc words of a normalized superaccumulator, or sums of balanced words
+     * \param words number of words
+     */
+    static void BalanceWords(int64_t * acc, int words);
+
+    /**
+     * Function for adding the words of a normalized superaccumulator into words shared with other threads
+     * or processes, with atomic additions and carry-save bits as in AccumulateWord whatever THREADSAFE,
+     * so that concurrent additions need no lock. The result is not normalized
+     * \param acc shared words receiving the sum
+     * \param other words of the superaccumulator to add, normalized
+     * \param words number of words of both, i.e. f_words + e_words
+     */
+    static void AccumulateWordsAtomic(int64_t * acc, int64_t const * other, int words);
+
 private:
     void AccumulateWord(int64_t x, int i);
+    bool RoundParts(double & hi, double & lo);
 
     static constexpr unsigned int K = 12;    // High-radix carry-save bits
     static constexpr int digits = 64 - K;
@@ -179,7 +213,8 @@ inline void Superaccumulator::Accumulate(double x)
     int exp_word = e / digits;  // Word containing MSbit (upper bound)
     int iup = exp_word + f_words;
     
-    double xscaled = myldexp(x, -digits * exp_word);
+    // Subnormals have no implicit bit, so that they are scaled by an exact multiplication instead
+    double xscaled = likely(biased_exponent(x) != 0) ? myldexp(x, -digits * exp_word) : x * exp2i(-digits * exp_word);
 
     int i;
     for(i = iup; xscaled != 0; --i) {
@@ -207,6 +242,8 @@ inline std::vector<int64_t> Superaccumulator::get_accumulator(){
 
 inline void Superaccumulator::set_accumulator(std::vector<int64_t> other){
     accumulator = other;
+    imin = 0;
+    imax = f_words + e_words - 1;
 }
 
 #endif
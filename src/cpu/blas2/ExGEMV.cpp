@@ -0,0 +1,316 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "ExDOT.hpp"
+#include "blas2.hpp"
+
+
+/*
+ * Calls f(l, r) on the parts [l, r) of count output elements of len products each,
+ * split evenly among the threads at multiples of align, or on all of them from the calling thread for small sizes
+ */
+template<typename F>
+static void ExGemvParallel(ExContext & ctx, int count, int64_t len, int align, F f) {
+    if (ctx.Serial(int64_t(count) * len)) {
+        f(0, count);
+        return;
+    }
+    ctx.pool.Parallel(ctx.nthreads, [&](unsigned int tid, unsigned int tnum) {
+        int l = int(int64_t(count) * tid / tnum) / align * align;
+        int r = (tid + 1 == tnum) ? count : int(int64_t(count) * (tid + 1) / tnum) / align * align;
+        f(l, r);
+    });
+}
+
+/*
+ * Output elements that are the dot products of the contiguous columns of a with ax, as with transa = 'T'
+ */
+struct ExGemvDots {
+    static int constexpr align = 1; /**< number of output elements processed together */
+    double const * a;
+    int64_t lda;
+    double const * ax;
+    int64_t len;
+    Superaccumulator * accs;
+
+    void Superacc(int l, int r) const {
+        for (int k = l; k < r; ++k) {
+            DotInput<double, Vec4d> in(a + k * lda, 1, ax, 1);
+            for (int64_t i = 0; i < len; ++i)
+                in.Accumulate(accs[k], i);
+            accs[k].Normalize();
+        }
+    }
+    template<typename CACHE>
+    void FPE(int l, int r) const {
+        for (int k = l; k < r; ++k)
+            ExAccumulateFPE<CACHE, EXBLAS_FPE_INTERLEAVE>(DotInput<double, Vec4d>(a + k * lda, 1, ax, 1), 0, len, EXBLAS_PREFETCH_DISTANCE, accs[k]);
+    }
+};
+
+/*
+ * Output elements that are the products of the rows of a with ax, as with transa = 'N'. The matrix is read
+ * column by column, the products of each column being added to the accumulators of their rows, so that
+ * the accesses stay contiguous: each lane of the expansions sums the products of its own row
+ */
+struct ExGemvRows {
+    static int constexpr align = 8; /**< number of output elements processed together */
+    double const * a;
+    int64_t lda;
+    double const * ax;
+    int64_t len;
+    Superaccumulator * accs;
+
+    void Superacc(int l, int r) const {
+        for (int64_t j = 0; j < len; ++j) {
+            double const * col = a + j * lda;
+            for (int k = l; k < r; ++k) {
+                double p = col[k] * ax[j];
+                accs[k].Accumulate(p);
+                accs[k].Accumulate(std::fma(col[k], ax[j], -p));
+            }
+        }
+        for (int k = l; k < r; ++k)
+            accs[k].Normalize();
+    }
+    template<typename CACHE>
+    void FPE(int l, int r) const {
+        // Lanes past the last row sum zeros into a scratch superaccumulator
+        Superaccumulator scratch(e_bits, f_bits);
+        for (int k = l; k < r; k += align) {
+            int n = std::min(r - k, int(align));
+            Superaccumulator * lanes[align];
+            for (int i = 0; i != align; ++i)
+                lanes[i] = (i < n) ? &accs[k + i] : &scratch;
+            CACHE lo(lanes), hi(lanes + 4);
+            for (int64_t j = 0; j < len; ++j) {
+                double const * col = a + j * lda + k;
+                Vec4d x(ax[j]), e, p;
+                if (n == align) {
+                    p = TwoProductFMA(Vec4d().load(col), x, e);
+                    lo.Accumulate(p, e);
+                    p = TwoProductFMA(Vec4d().load(col + 4), x, e);
+                    hi.Accumulate(p, e);
+                } else {
+                    p = TwoProductFMA(ExLoadPartial(col, 1, std::min(n, 4)), x, e);
+                    lo.Accumulate(p, e);
+                    if (n > 4) {
+                        p = TwoProductFMA(ExLoadPartial(col + 4, 1, n - 4), x, e);
+                        hi.Accumulate(p, e);
+                    }
+                }
+            }
+            lo.Flush();
+            hi.Flush();
+            for (int i = 0; i != n; ++i)
+                accs[k + i].Normalize();
+        }
+    }
+};
+
+/*
+ * Accumulates the output elements of kernel in [l, r) with floating-point expansions of type CACHE
+ */
+template<typename CACHE, typename KERNEL>
+static void ExGemvFPE(ExContext & ctx, int count, KERNEL const & kernel) {
+    ExGemvParallel(ctx, count, kernel.len, KERNEL::align, [&](int l, int r) {
+        kernel.template FPE<CACHE>(l, r);
+    });
+}
+
+/*
+ * Accumulates the count output elements of kernel into their superaccumulators
+ * If fpe < 3, use superaccumulators only,
+ * Otherwise, use floating-point expansions of size FPE with superaccumulators when needed
+ */
+template<typename KERNEL>
+static void ExGemvAccumulate(ExContext & ctx, int count, KERNEL const & kernel, int fpe, bool early_exit) {
+    if (fpe < 3) {
+        ExGemvParallel(ctx, count, kernel.len, KERNEL::align, [&](int l, int r) {
+            kernel.Superacc(l, r);
+        });
+    } else if (early_exit) {
+        if (fpe <= 4)
+            ExGemvFPE<FPExpansionVect<Vec4d, 4, FPExpansionTraits<true> > >(ctx, count, kernel);
+        else if (fpe <= 6)
+            ExGemvFPE<FPExpansionVect<Vec4d, 6, FPExpansionTraits<true> > >(ctx, count, kernel);
+        else
+            ExGemvFPE<FPExpansionVect<Vec4d, 8, FPExpansionTraits<true> > >(ctx, count, kernel);
+    } else switch (fpe) {
+        case 3: ExGemvFPE<FPExpansionVect<Vec4d, 3> >(ctx, count, kernel); break;
+        case 4: ExGemvFPE<FPExpansionVect<Vec4d, 4> >(ctx, count, kernel); break;
+        case 5: ExGemvFPE<FPExpansionVect<Vec4d, 5> >(ctx, count, kernel); break;
+        case 6: ExGemvFPE<FPExpansionVect<Vec4d, 6> >(ctx, count, kernel); break;
+        case 7: ExGemvFPE<FPExpansionVect<Vec4d, 7> >(ctx, count, kernel); break;
+        default: ExGemvFPE<FPExpansionVect<Vec4d, 8> >(ctx, count, kernel); break;
+    }
+}
+
+/*
+ * Accumulates the exact product beta * y into acc, as the last term of an output element
+ */
+static void ExGemvBeta(Superaccumulator & acc, double beta, double y) {
+    if (beta == 0.0)
+        return;
+    double p = beta * y;
+    acc.Accumulate(p);
+    acc.Accumulate(std::fma(beta, y, -p));
+}
+
+/*
+ * Matrix-vector product using our algorithm, for column-major matrices
+ * Each element of y is the exact sum of the products of a row (or a column, with transa = 'T')
+ * of A with alpha * x and of beta * y, rounded once; the elements are shared among the threads
+ */
+int exgemv(const char transa, const int m, const int n, const double alpha, double *a, const int lda, const int offseta, double *x, const int incx, const int offsetx, const double beta, double *y, const int incy, const int offsety, const int fpe, const bool early_exit) {
+    return exgemv(exblas::default_context(), transa, m, n, alpha, a, lda, offseta, x, incx, offsetx, beta, y, incy, offsety, fpe, early_exit);
+}
+
+int exgemv(exblas::Context & context, const char transa, const int m, const int n, const double alpha, double *a, const int lda, const int offseta, double *x, const int incx, const int offsetx, const double beta, double *y, const int incy, const int offsety, int fpe, const bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    bool trans = (transa == 'T') || (transa == 't');
+    int leny = trans ? n : m;
+    int lenx = trans ? m : n;
+    double *a0 = a + offseta;
+    double *x0 = ExFirst(x, lenx, incx, offsetx);
+    double *y0 = ExFirst(y, leny, incy, offsety);
+
+    // alpha * x is rounded once for all the output elements
+    std::vector<double> ax(lenx);
+    for (int j = 0; j != lenx; ++j)
+        ax[j] = alpha * x0[int64_t(j) * incx];
+
+    static const Superaccumulator zero(e_bits, f_bits);
+    std::vector<Superaccumulator> accs(leny, zero);
+    if (trans) {
+        ExGemvDots kernel = {a0, lda, ax.data(), lenx, accs.data()};
+        ExGemvAccumulate(ctx, leny, kernel, fpe, early_exit);
+    } else {
+        ExGemvRows kernel = {a0, lda, ax.data(), lenx, accs.data()};
+        ExGemvAccumulate(ctx, leny, kernel, fpe, early_exit);
+    }
+
+    for (int k = 0; k != leny; ++k) {
+        double & yk = y0[int64_t(k) * incy];
+        ExGemvBeta(accs[k], beta, yk);
+        yk = accs[k].Round();
+    }
+
+    return 0;
+}
+
+/*
+ * Matrix-vector product of a matrix distributed over the participants of transport using our algorithm
+ * Each participant accumulates the products of its submatrix into the superaccumulators of the output
+ * elements it touches. When each of them holds whole rows of the matrix (columns with transa = 'T'),
+ * it rounds its elements locally; otherwise, the superaccumulators are merged exactly by a reduce-scatter
+ * and each participant rounds a block of the elements. Only the rounded elements are then gathered,
+ * so y is the same on every participant and independent of the distribution of the matrix
+ */
+int exgemv_dist(const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, exblas::Transport & transport, const int fpe, const bool early_exit) {
+    return exgemv_dist(exblas::default_context(), transa, m, n, local_m, rows, local_n, cols, alpha, a, lda, x, beta, y, transport, fpe, early_exit);
+}
+
+int exgemv_dist(exblas::Context & context, const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, exblas::Transport & transport, int fpe, const bool early_exit) {
+    ExContext & ctx = context.impl();
+
+    fpe = ExClampFPE(fpe);
+
+    bool trans = (transa == 'T') || (transa == 't');
+    int leny = trans ? n : m;
+    // Local output elements, and the global indices of the ones of x they multiply
+    int count = trans ? local_n : local_m;
+    int len = trans ? local_m : local_n;
+    int const *outs = trans ? cols : rows;
+    int const *ins = trans ? rows : cols;
+
+    std::vector<double> ax(len);
+    for (int j = 0; j != len; ++j)
+        ax[j] = alpha * x[ins ? ins[j] : j];
+
+    static const Superaccumulator zero(e_bits, f_bits);
+    std::vector<Superaccumulator> local(count, zero);
+    if (trans) {
+        ExGemvDots kernel = {a, lda, ax.data(), len, local.data()};
+        ExGemvAccumulate(ctx, count, kernel, fpe, early_exit);
+    } else {
+        ExGemvRows kernel = {a, lda, ax.data(), len, local.data()};
+        ExGemvAccumulate(ctx, count, kernel, fpe, early_exit);
+    }
+
+    // Participants holding whole rows, or none, contribute alone to their elements; the others share theirs
+    int rank = transport.get_rank(), size = transport.get_size();
+    int lenx = trans ? m : n;
+    std::vector<int64_t> parts(size, 0);
+    std::vector<int> counts(size, 1);
+    parts[rank] = ((lenx > 0) && ((count == 0) || (len == lenx))) ? count : -1;
+    transport.allgather(&parts[0], &counts[0]);
+
+    std::vector<int64_t> values;
+    if (std::find(parts.begin(), parts.end(), -1) == parts.end()) {
+        // Each element is gathered as its index followed by its bits
+        int64_t first = 0, total = 0;
+        for (int r = 0; r != size; ++r) {
+            first += (r < rank) ? parts[r] : 0;
+            total += parts[r];
+            counts[r] = 2 * parts[r];
+        }
+        values.resize(2 * total);
+        for (int k = 0; k != count; ++k) {
+            int i = outs ? outs[k] : k;
+            ExGemvBeta(local[k], beta, y[i]);
+            double yi = local[k].Round();
+            values[2 * (first + k)] = i;
+            memcpy(&values[2 * (first + k) + 1], &yi, sizeof(double));
+        }
+        transport.allgather(values.data(), &counts[0]);
+        for (int64_t k = 0; k != total; ++k)
+            memcpy(&y[values[2 * k]], &values[2 * k + 1], sizeof(double));
+    } else {
+        // Elements of y outside the submatrix stay empty here, and beta * y is counted once, by participant 0.
+        // Participant r rounds the elements of block r
+        std::vector<Superaccumulator> accs(leny, zero);
+        for (int k = 0; k != count; ++k)
+            accs[outs ? outs[k] : k].Accumulate(local[k]);
+        if (rank == 0) {
+            for (int k = 0; k != leny; ++k)
+                ExGemvBeta(accs[k], beta, y[k]);
+        }
+        for (int r = 0; r != size; ++r)
+            counts[r] = int(int64_t(leny) * (r + 1) / size) - int(int64_t(leny) * r / size);
+        ExReduceScatterBatch(accs, transport, &counts[0], y);
+        values.resize(leny);
+        int first = int(int64_t(leny) * rank / size);
+        memcpy(&values[first], &y[first], counts[rank] * sizeof(double));
+        transport.allgather(values.data(), &counts[0]);
+        memcpy(y, values.data(), leny * sizeof(double));
+    }
+
+    return 0;
+}
+
+#ifdef EXBLAS_MPI
+/*
+ * Same product over the processes of comm, merged by an MpiTransport
+ */
+int exgemv_dist(const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, MPI_Comm comm, const int fpe, const bool early_exit) {
+    return exgemv_dist(exblas::default_context(), transa, m, n, local_m, rows, local_n, cols, alpha, a, lda, x, beta, y, comm, fpe, early_exit);
+}
+
+int exgemv_dist(exblas::Context & context, const char transa, const int m, const int n, const int local_m, const int *rows, const int local_n, const int *cols, const double alpha, double *a, const int lda, double *x, const double beta, double *y, MPI_Comm comm, const int fpe, const bool early_exit) {
+    exblas::MpiTransport transport(comm);
+    return exgemv_dist(context, transa, m, n, local_m, rows, local_n, cols, alpha, a, lda, x, beta, y, transport, fpe, early_exit);
+}
+#endif
@@ -12,9 +12,6 @@
 #define EXDOT_KERNEL          "ExDOT"
 #define EXDOT_COMPLETE_KERNEL "ExDOTComplete"
 
-static size_t szKernelLength;                // Byte size of kernel code
-static char* cSources = NULL;                // Buffer to hold source for compilation
-
 static cl_program       cpProgram;           //OpenCL Superaccumulator program
 static cl_kernel        ckKernel;            //OpenCL Superaccumulator kernels
 static cl_kernel        ckComplete;
@@ -41,47 +38,18 @@ static char  compileOptions[256] = "-DWARP_COUNT=16 -DWARP_SIZE=16 -DMERGE_WORKG
 // GPU reduction related functions
 ////////////////////////////////////////////////////////////////////////////////
 extern "C" cl_int initExDOT(
-    cl_context cxGPUContext,
-    cl_command_queue cqParamCommandQue,
-    cl_device_id cdDevice,
+    ExOCLHandle *ocl,
     const char* program_file,
     const uint NbFPE
 ){
     cl_int ciErrNum;
 
-    // Read the OpenCL kernel in from source file
-    FILE *program_handle;
-    program_handle = fopen(program_file, "r");
-    if (!program_handle) {
-        fprintf(stderr, "Failed to load kernel.\n");
-        exit(1);
-    }
-    fseek(program_handle, 0, SEEK_END);
-    szKernelLength = ftell(program_handle);
-    rewind(program_handle);
-    cSources = (char *) malloc(szKernelLength + 1);
-    cSources[szKernelLength] = '\0';
-    ciErrNum = fread(cSources, sizeof(char), szKernelLength, program_handle);
-    fclose(program_handle);
-
-    cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cSources, &szKernelLength, &ciErrNum);
-    if (ciErrNum != CL_SUCCESS) {
-        printf("Error in clCreateProgramWithSource, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    //Built once per set of options, then taken from the cache
+    char options[sizeof(compileOptions) + 32];
+    sprintf(options, "%s -DNBFPE=%d", compileOptions, NbFPE);
+    cpProgram = ExOCLProgram(*ocl, program_file, options, &ciErrNum);
+    if (ciErrNum != CL_SUCCESS)
         return EXIT_FAILURE;
-    }
-
-    sprintf(compileOptions, "%s -DNBFPE=%d", compileOptions, NbFPE);
-    ciErrNum = clBuildProgram(cpProgram, 0, NULL, compileOptions, NULL, NULL);
-    if (ciErrNum != CL_SUCCESS) {
-        printf("Error in clBuildProgram, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-
-        // Determine the reason for the error
-        char buildLog[16384];
-        clGetProgramBuildInfo(cpProgram, cdDevice, CL_PROGRAM_BUILD_LOG, sizeof(buildLog), &buildLog, NULL);
-        printf("%s\n", buildLog);
-
-        return EXIT_FAILURE;
-    }
 
     ckKernel = clCreateKernel(cpProgram, EXDOT_KERNEL, &ciErrNum);
     if (ciErrNum != CL_SUCCESS) {
@@ -96,17 +64,14 @@ extern "C" cl_int initExDOT(
 
     uint size = PARTIAL_SUPERACCS_COUNT;
     size = size * bin_count * sizeof(cl_long);
-    d_PartialSuperaccs = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, size, NULL, &ciErrNum);
+    d_PartialSuperaccs = ExOCLBuffer(*ocl, "ExDOT.PartialSuperaccs", size, &ciErrNum);
     if (ciErrNum != CL_SUCCESS) {
         printf("Error in clCreateBuffer for d_PartialSuperaccs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
         return EXIT_FAILURE;
     }
 
     //Save default command queue
-    cqDefaultCommandQue = cqParamCommandQue;
-
-    //Discard temp storage
-    free(cSources);
+    cqDefaultCommandQue = ocl->queue;
 
     return EXIT_SUCCESS;
 }
@@ -114,10 +79,9 @@ extern "C" cl_int initExDOT(
 extern "C" void closeExDOT(void){
     cl_int ciErrNum;
 
-    ciErrNum = clReleaseMemObject(d_PartialSuperaccs);
-    ciErrNum |= clReleaseKernel(ckKernel);
+    // The program and the buffers are kept by the OpenCL handle for the next calls
+    ciErrNum = clReleaseKernel(ckKernel);
     ciErrNum |= clReleaseKernel(ckComplete);
-    ciErrNum |= clReleaseProgram(cpProgram);
     if (ciErrNum != CL_SUCCESS) {
         printf("Error in closeExDOT(), Line %u in file %s !!!\n\n", __LINE__, __FILE__);
     }
@@ -95,53 +95,36 @@ static double runExDOT(const int N, double *h_a, const int inca, const int offse
     double h_Res;
     cl_int ciErrNum;
 
-    // Initializing OpenCL
-        char platform_name[64];
-#ifdef AMD
-        strcpy(platform_name, "AMD Accelerated Parallel Processing");
-#else
-        strcpy(platform_name, "NVIDIA CUDA");
-#endif
-        cl_platform_id cpPlatform = GetOCLPlatform(platform_name);
-        if (cpPlatform == NULL) {
-            printf("ERROR: Failed to find the platform '%s' ...\n", platform_name);
+    //Initializing OpenCL, once per process; the calls of several threads run one at a time
+        std::lock_guard<std::mutex> lock(ExOCLMutex());
+        ExOCLHandle *ocl = ExOCL();
+        if (ocl == NULL)
             return -1;
-        }
+        cl_command_queue cqCommandQueue = ocl->queue;
 
-        //Get a GPU device
-        cl_device_id cdDevice = GetOCLDevice(cpPlatform);
-        if (cdDevice == NULL) {
-            printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            return -1;
-        }
-
-        //Create the context
-        cl_context cxGPUContext = clCreateContext(0, 1, &cdDevice, NULL, NULL, &ciErrNum);
+        //Copying the inputs into the scratch buffers
+        cl_mem d_a = ExOCLBuffer(*ocl, "ExDOT.a", N * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateContext, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("N = %d\t ciErrNum = %d\n", N, ciErrNum);
+            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Create a command-queue
-        cl_command_queue cqCommandQueue = clCreateCommandQueue(cxGPUContext, cdDevice, CL_QUEUE_PROFILING_ENABLE, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_a, CL_FALSE, 0, N * sizeof(cl_double), h_a, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateCommandQueue, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Allocating OpenCL memory...
-        cl_mem d_a = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, N * sizeof(cl_double), h_a, &ciErrNum);
+        cl_mem d_b = ExOCLBuffer(*ocl, "ExDOT.b", N * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("N = %d\t ciErrNum = %d\n", N, ciErrNum);
-            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_b = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, N * sizeof(cl_double), h_b, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_b, CL_FALSE, 0, N * sizeof(cl_double), h_b, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_Res = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, sizeof(cl_double), NULL, &ciErrNum);
+        cl_mem d_Res = ExOCLBuffer(*ocl, "ExDOT.Res", sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
             printf("Error in clCreateBuffer for d_res, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
@@ -149,7 +132,7 @@ static double runExDOT(const int N, double *h_a, const int inca, const int offse
 
     {
         //Initializing OpenCL ExDOT
-            ciErrNum = initExDOT(cxGPUContext, cqCommandQueue, cdDevice, program_file, fpe);
+            ciErrNum = initExDOT(ocl, program_file, fpe);
             if (ciErrNum != CL_SUCCESS)
                 exit(EXIT_FAILURE);
 
@@ -204,19 +187,8 @@ static double runExDOT(const int N, double *h_a, const int inca, const int offse
                 exit(EXIT_FAILURE);
             }
 
-         //Release kernels and program
-         //Shutting down and freeing memory
+         //Release kernels; the context, programs and buffers are kept for the next calls
             closeExDOT();
-            if(d_a)
-                clReleaseMemObject(d_a);
-            if(d_b)
-                clReleaseMemObject(d_b);
-            if(d_Res)
-                clReleaseMemObject(d_Res);
-            if(cqCommandQueue)
-                clReleaseCommandQueue(cqCommandQueue);
-            if(cxGPUContext)
-                clReleaseContext(cxGPUContext);
     }
 
     return h_Res;
@@ -13,9 +13,6 @@
 #define EXSUM_COMPLETE_KERNEL "ExSUMComplete"
 #define ROUND_KERNEL          "ExSUMRound"
 
-static size_t szKernelLength;                // Byte size of kernel code
-static char* cSources = NULL;                // Buffer to hold source for compilation
-
 static cl_program       cpProgram;           //OpenCL Superaccumulator program
 static cl_kernel        ckKernel;            //OpenCL Superaccumulator kernels
 static cl_kernel        ckComplete;
@@ -45,9 +42,7 @@ static char  compileOptions[256] = "-DWARP_COUNT=16 -DWARP_SIZE=16 -DMERGE_WORKG
 // GPU reduction related functions
 ////////////////////////////////////////////////////////////////////////////////
 extern "C" cl_int initExSUM(
-    cl_context cxGPUContext,
-    cl_command_queue cqParamCommandQue,
-    cl_device_id cdDevice,
+    ExOCLHandle *ocl,
     const char* program_file,
     const uint NbElems,
     const uint NbFPE
@@ -55,42 +50,12 @@ extern "C" cl_int initExSUM(
     cl_int ciErrNum;
     NbElements = NbElems;
 
-    // Read the OpenCL kernel in from source file
-    FILE *program_handle;
-    // Load the program sources
-    program_handle = fopen(program_file, "r");
-    if (!program_handle) {
-        fprintf(stderr, "Failed to load kernel.\n");
-        exit(1);
-    }
-    fseek(program_handle, 0, SEEK_END);
-    szKernelLength = ftell(program_handle);
-    rewind(program_handle);
-    cSources = (char *) malloc(szKernelLength + 1);
-    cSources[szKernelLength] = '\0';
-    ciErrNum = fread(cSources, sizeof(char), szKernelLength, program_handle);
-    fclose(program_handle);
-
-    //printf("clCreateProgramWithSource...\n"); 
-        cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cSources, &szKernelLength, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateProgramWithSource, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    //Built once per set of options, then taken from the cache
+        char options[sizeof(compileOptions) + 32];
+        sprintf(options, "%s -DNBFPE=%d", compileOptions, NbFPE);
+        cpProgram = ExOCLProgram(*ocl, program_file, options, &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             return EXIT_FAILURE;
-        }
-
-    //printf("...building ExSUM program\n");
-        sprintf(compileOptions, "%s -DNBFPE=%d", compileOptions, NbFPE);
-        ciErrNum = clBuildProgram(cpProgram, 0, NULL, compileOptions, NULL, NULL);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clBuildProgram, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-
-            // Determine the reason for the error
-            char buildLog[16384];
-            clGetProgramBuildInfo(cpProgram, cdDevice, CL_PROGRAM_BUILD_LOG, sizeof(buildLog), &buildLog, NULL);
-            printf("%s\n", buildLog);
-
-            return EXIT_FAILURE;
-        }
 
     //printf("...creating ExSUM kernels:\n");
         ckKernel = clCreateKernel(cpProgram, EXSUM_KERNEL, &ciErrNum);
@@ -112,22 +77,15 @@ extern "C" cl_int initExSUM(
     //printf("...allocating internal buffer\n");
         uint size = PARTIAL_SUPERACCS_COUNT;
         size = size * bin_count * sizeof(cl_long);
-        d_PartialSuperaccs = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, size, NULL, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_PartialSuperaccs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+        d_PartialSuperaccs = ExOCLBuffer(*ocl, "ExSUM.PartialSuperaccs", size, &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             return EXIT_FAILURE;
-        }
-        d_Superacc = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, bin_count * sizeof(bintype), NULL, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_Superacc, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+        d_Superacc = ExOCLBuffer(*ocl, "ExSUM.Superacc", bin_count * sizeof(bintype), &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             return EXIT_FAILURE;
-        }
 
     //Save default command queue
-    cqDefaultCommandQue = cqParamCommandQue;
-
-    //Discard temp storage
-    free(cSources);
+    cqDefaultCommandQue = ocl->queue;
 
     return EXIT_SUCCESS;
 }
@@ -135,12 +93,10 @@ extern "C" cl_int initExSUM(
 extern "C" void closeExSUM(void){
     cl_int ciErrNum;
 
-    ciErrNum = clReleaseMemObject(d_PartialSuperaccs);
-    ciErrNum |= clReleaseMemObject(d_Superacc);
-    ciErrNum |= clReleaseKernel(ckKernel);
+    // The program and the buffers are kept by the OpenCL handle for the next calls
+    ciErrNum = clReleaseKernel(ckKernel);
     ciErrNum |= clReleaseKernel(ckComplete);
     ciErrNum |= clReleaseKernel(ckRound);
-    ciErrNum |= clReleaseProgram(cpProgram);
     if (ciErrNum != CL_SUCCESS) {
         printf("Error in closeExSUM(), Line %u in file %s !!!\n\n", __LINE__, __FILE__);
     }
@@ -86,56 +86,29 @@ static double runExSUM(const int N, double *h_a, const int inca, const int offse
     double h_Res;
     cl_int ciErrNum;
 
-    //printf("Initializing OpenCL...\n");
-        char platform_name[64];
-#ifdef AMD
-        strcpy(platform_name, "AMD Accelerated Parallel Processing");
-#else
-        strcpy(platform_name, "NVIDIA CUDA");
-#endif
-        cl_platform_id cpPlatform = GetOCLPlatform(platform_name);
-        if (cpPlatform == NULL) {
-            printf("ERROR: Failed to find the platform '%s' ...\n", platform_name);
-            return -1;
-        }
-
-        //Get a GPU device
-        cl_device_id cdDevice = GetOCLDevice(cpPlatform);
-        if (cdDevice == NULL) {
-            printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    //Initializing OpenCL, once per process; the calls of several threads run one at a time
+        std::lock_guard<std::mutex> lock(ExOCLMutex());
+        ExOCLHandle *ocl = ExOCL();
+        if (ocl == NULL)
             return -1;
-        }
-
-        //Create the context
-        cl_context cxGPUContext = clCreateContext(0, 1, &cdDevice, NULL, NULL, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateContext, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            exit(EXIT_FAILURE);
-        }
+        cl_command_queue cqCommandQueue = ocl->queue;
 
-        //Create a command-queue
-        cl_command_queue cqCommandQueue = clCreateCommandQueue(cxGPUContext, cdDevice, CL_QUEUE_PROFILING_ENABLE, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error = %d\n", ciErrNum);
-            printf("Error in clCreateCommandQueue, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+        //Copying the input into the scratch buffers
+        cl_mem d_a = ExOCLBuffer(*ocl, "ExSUM.a", N * sizeof(cl_double), &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             exit(EXIT_FAILURE);
-        }
-
-        //Allocating OpenCL memory...
-        cl_mem d_a = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, N * sizeof(cl_double), h_a, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_a, CL_FALSE, 0, N * sizeof(cl_double), h_a, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_Res = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, sizeof(cl_double), NULL, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_res, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+        cl_mem d_Res = ExOCLBuffer(*ocl, "ExSUM.Res", sizeof(cl_double), &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             exit(EXIT_FAILURE);
-        }
 
     {
         //Initializing OpenCL dSum...
-            ciErrNum = initExSUM(cxGPUContext, cqCommandQueue, cdDevice, program_file, N, fpe);
+            ciErrNum = initExSUM(ocl, program_file, N, fpe);
             if (ciErrNum != CL_SUCCESS)
                 exit(EXIT_FAILURE);
 
@@ -191,17 +164,8 @@ static double runExSUM(const int N, double *h_a, const int inca, const int offse
                 exit(EXIT_FAILURE);
             }
 
-         //Release kernels and program
-         //Shutting down and freeing memory...
+         //Release kernels; the context, programs and buffers are kept for the next calls
             closeExSUM();
-            if(d_a)
-                clReleaseMemObject(d_a);
-            if(d_Res)
-                clReleaseMemObject(d_Res);
-            if(cqCommandQueue)
-                clReleaseCommandQueue(cqCommandQueue);
-            if(cxGPUContext)
-                clReleaseContext(cxGPUContext);
     }
 
     return h_Res;
@@ -15,9 +15,6 @@
 #define GEMVT_KERNEL "gemvT"
 #define GEMV_REDUCE "gemv_reduce"
 
-static size_t szKernelLength;                // Byte size of kernel code
-static char* cSources = NULL;                // Buffer to hold source for compilation
-
 static cl_program       cpProgram;           //OpenCL program
 static cl_kernel        ckGEMV, ckDGEMV;     //OpenCL kernels
 static cl_kernel        ckGEMVReduce;        //OpenCL kernels
@@ -39,9 +36,7 @@ static char  compileOptions[256] = "-DNVIDIA -DUSE_KNUTH -DWORKGROUP_SIZE=256 -c
 // GPU reduction related functions
 ////////////////////////////////////////////////////////////////////////////////
 extern "C" cl_int initExGEMV(
-    cl_context cxGPUContext,
-    cl_command_queue cqParamCommandQue,
-    cl_device_id cdDevice,
+    ExOCLHandle *ocl,
     const char* program_file,
 	const char transa,
     const uint m,
@@ -51,43 +46,12 @@ extern "C" cl_int initExGEMV(
     cl_int ciErrNum;
     p = ip;
 
-    // Read the OpenCL kernel in from source file
-    FILE *program_handle;
-    //printf("Load the program sources (%s)...\n", program_file);
-    program_handle = fopen(program_file, "r");
-    if (!program_handle) {
-        fprintf(stderr, "Failed to load kernel.\n");
-        exit(1);
-    }
-    fseek(program_handle, 0, SEEK_END);
-    szKernelLength = ftell(program_handle);
-    rewind(program_handle);
-    cSources = (char *) malloc(szKernelLength + 1);
-    cSources[szKernelLength] = '\0';
-    ciErrNum = fread(cSources, sizeof(char), szKernelLength, program_handle);
-    fclose(program_handle);
-
-    //printf("clCreateProgramWithSource...\n"); 
-        cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cSources, &szKernelLength, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateProgramWithSource, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            return EXIT_FAILURE;
-        }
-
-    //printf("...building ExGEMV program\n");
+    //Built once per set of options, then taken from the cache
         char compileOptionsBak[256];
         sprintf(compileOptionsBak, "%s -DNBFPE=%d", compileOptions, NbFPE);
-        ciErrNum = clBuildProgram(cpProgram, 0, NULL, compileOptionsBak, NULL, NULL);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clBuildProgram, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-
-            // Determine the reason for the error
-            char buildLog[8192];
-            clGetProgramBuildInfo(cpProgram, cdDevice, CL_PROGRAM_BUILD_LOG, sizeof(buildLog), &buildLog, NULL);
-            printf("%s\n", buildLog);
-
+        cpProgram = ExOCLProgram(*ocl, program_file, compileOptionsBak, &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             return EXIT_FAILURE;
-        }
 
     if (NbFPE == 1){
         ckDGEMV = clCreateKernel(cpProgram, (transa == 'T' ? DGEMVT_KERNEL : DGEMV_KERNEL), &ciErrNum);
@@ -109,7 +73,7 @@ extern "C" cl_int initExGEMV(
         }
 
         //printf("...allocating internal buffer\n");
-        d_Superaccs = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, m * p * bin_count * sizeof(cl_long), NULL, &ciErrNum);
+        d_Superaccs = ExOCLBuffer(*ocl, "ExGEMV.Superaccs", m * p * bin_count * sizeof(cl_long), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
             printf("Error in clCreateBuffer, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             return EXIT_FAILURE;
@@ -117,10 +81,7 @@ extern "C" cl_int initExGEMV(
     }
 
     //Save default command queue
-    cqDefaultCommandQue = cqParamCommandQue;
-
-    //Discard temp storage
-    free(cSources);
+    cqDefaultCommandQue = ocl->queue;
 
     return EXIT_SUCCESS;
 }
@@ -128,10 +89,8 @@ extern "C" cl_int initExGEMV(
 extern "C" void closeExGEMV(void){
     cl_int ciErrNum = CL_SUCCESS;
 
-    if (d_Superaccs){
-        ciErrNum = clReleaseMemObject(d_Superaccs);
-        d_Superaccs = NULL;
-    }
+    // The program and the buffers are kept by the OpenCL handle for the next calls
+    d_Superaccs = NULL;
     if (ckDGEMV) {
         ciErrNum |= clReleaseKernel(ckDGEMV);
         ckDGEMV = NULL;
@@ -144,7 +103,6 @@ extern "C" void closeExGEMV(void){
         ciErrNum |= clReleaseKernel(ckGEMVReduce);
         ckGEMVReduce = NULL;
     }
-    ciErrNum |= clReleaseProgram(cpProgram);
 
     if (ciErrNum != CL_SUCCESS) {
         printf("Error in closeExGEMV(), Line %u in file %s !!!\n\n", __LINE__, __FILE__);
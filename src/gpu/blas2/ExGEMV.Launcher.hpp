@@ -31,6 +31,8 @@
     #include <CL/opencl.h>
 #endif
 
+#include "common.gpu.hpp"
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Common definitions
@@ -43,12 +45,10 @@ typedef long long int bintype;
 ////////////////////////////////////////////////////////////////////////////////
 /**
  * \ingroup ExGEMV
- * \brief Function to initialize execution on GPUs by allocating kernels and 
- *     memory space. For internal use
+ * \brief Function to initialize execution on GPUs by creating kernels and taking
+ *     memory space from the OpenCL handle. For internal use
  *
- * \param cxGPUContext GPU context
- * \param cqParamCommandQue Command queue
- * \param cdDevice Device ID
+ * \param ocl OpenCL objects kept from one call to another
  * \param program_file OpenCL file to execute
  * \param transa transpose ('T') or non-transpose ('N') matrix A
  * \param m nb of rows of matrix A
@@ -58,9 +58,7 @@ typedef long long int bintype;
  * \return Status
  */
 extern "C" cl_int initExGEMV(
-    cl_context cxGPUContext,
-    cl_command_queue cqParamCommandQue,
-    cl_device_id cdDevice,
+    ExOCLHandle *ocl,
     const char* program_file,
 	const char transa,
     const uint m,
@@ -109,60 +109,48 @@ int exgemv(const char transa, const int m, const int n, const double alpha, doub
 int runExGEMV(const char transa, const int m, const int n, const double alpha, double *a, const int lda, const int offseta, double *x, const int incx, const int offsetx, const double beta, double *y, const int incy, const int offsety, const int fpe, const char* program_file) {
     cl_int ciErrNum;
 
-    //printf("Initializing OpenCL...\n");
-        char platform_name[64];
-#ifdef AMD
-        strcpy(platform_name, "AMD Accelerated Parallel Processing");
-#else
-        strcpy(platform_name, "NVIDIA CUDA");
-#endif
-        cl_platform_id cpPlatform = GetOCLPlatform(platform_name);
-        if (cpPlatform == NULL) {
-            printf("ERROR: Failed to find the platform '%s' ...\n", platform_name);
+    //Initializing OpenCL, once per process; the calls of several threads run one at a time
+        std::lock_guard<std::mutex> lock(ExOCLMutex());
+        ExOCLHandle *ocl = ExOCL();
+        if (ocl == NULL)
             return -1;
-        }
+        cl_command_queue cqCommandQueue = ocl->queue;
 
-        //Get a GPU device
-        cl_device_id cdDevice = GetOCLDevice(cpPlatform);
-        if (cdDevice == NULL) {
-            printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            return -1;
-        }
-
-        //Create the context
-        cl_context cxGPUContext = clCreateContext(0, 1, &cdDevice, NULL, NULL, &ciErrNum);
+        //Copying the inputs into the scratch buffers
+        cl_mem d_a = ExOCLBuffer(*ocl, "ExGEMV.a", m * n * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateContext, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Create a command-queue
-        cl_command_queue cqCommandQueue = clCreateCommandQueue(cxGPUContext, cdDevice, CL_QUEUE_PROFILING_ENABLE, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_a, CL_FALSE, 0, m * n * sizeof(cl_double), a, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateCommandQueue, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Allocating OpenCL memory...
-        cl_mem d_a = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m * n * sizeof(cl_double), a, &ciErrNum);
+        cl_mem d_x = ExOCLBuffer(*ocl, "ExGEMV.x", ((transa == 'T') ? m : n) * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_x, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_x = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, ((transa == 'T') ? m : n) * sizeof(cl_double), x, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_x, CL_FALSE, 0, ((transa == 'T') ? m : n) * sizeof(cl_double), x, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_x, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_x, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_y = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, ((transa == 'T') ? n : m) * sizeof(cl_double), y, &ciErrNum);
+        cl_mem d_y = ExOCLBuffer(*ocl, "ExGEMV.y", ((transa == 'T') ? n : m) * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
             printf("Error in clCreateBuffer for d_y, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_y, CL_FALSE, 0, ((transa == 'T') ? n : m) * sizeof(cl_double), y, 0, NULL, NULL);
+        if (ciErrNum != CL_SUCCESS) {
+            printf("Error in clEnqueueWriteBuffer for d_y, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            exit(EXIT_FAILURE);
+        }
 
     {
         //Initializing OpenCL dSum...
-        ciErrNum = initExGEMV(cxGPUContext, cqCommandQueue, cdDevice, program_file, transa, (transa == 'T') ? n : m, 1, fpe);
+        ciErrNum = initExGEMV(ocl, program_file, transa, (transa == 'T') ? n : m, 1, fpe);
         if (ciErrNum != CL_SUCCESS)
             exit(EXIT_FAILURE);
 
@@ -221,14 +209,8 @@ int runExGEMV(const char transa, const int m, const int n, const double alpha, d
                 exit(EXIT_FAILURE);
             }
 
-         //Release kernels and program
-         //Shutting down and freeing memory...
+         //Release kernels; the context, programs and buffers are kept for the next calls
             closeExGEMV();
-            clReleaseMemObject(d_a);
-            clReleaseMemObject(d_x);
-            clReleaseMemObject(d_y);
-            clReleaseCommandQueue(cqCommandQueue);
-            clReleaseContext(cxGPUContext);
     }
 
     return EXIT_SUCCESS;
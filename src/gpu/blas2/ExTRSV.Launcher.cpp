@@ -24,9 +24,6 @@
   #define BLOCK_SIZE 32
 #endif
 
-static size_t szKernelLength;                // Byte size of kernel code
-static char* cSources = NULL;                // Buffer to hold source for compilation
-
 static cl_program       cpProgram;           //OpenCL program
 static cl_kernel        ckDTRSV;             //OpenCL kernels
 static cl_kernel        ckInit, ckTRSV;      //OpenCL kernels
@@ -47,55 +44,19 @@ static char  compileOptions[256] = "-DNVIDIA -DUSE_KNUTH -DBLOCK_SIZE=32 -Dthrea
 // GPU reduction related functions
 ////////////////////////////////////////////////////////////////////////////////
 extern "C" cl_int initExTRSV(
-    cl_context cxGPUContext,
-    cl_command_queue cqParamCommandQue,
-    cl_device_id cdDevice,
+    ExOCLHandle *ocl,
     const char* program_file,
     const uint n,
     const uint NbFPE
 ){
     cl_int ciErrNum;
 
-    // Read the OpenCL kernel in from source file
-    FILE *program_handle;
-    //printf("Load the program sources (%s)...\n", program_file);
-    program_handle = fopen(program_file, "r");
-    if (!program_handle) {
-        fprintf(stderr, "Failed to load kernel.\n");
-        exit(1);
-    }
-    fseek(program_handle, 0, SEEK_END);
-    szKernelLength = ftell(program_handle);
-    rewind(program_handle);
-    cSources = (char *) malloc(szKernelLength + 1);
-    cSources[szKernelLength] = '\0';
-    ciErrNum = fread(cSources, sizeof(char), szKernelLength, program_handle);
-    fclose(program_handle);
-
-    //printf("clCreateProgramWithSource...\n"); 
-        cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cSources, &szKernelLength, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateProgramWithSource, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            return EXIT_FAILURE;
-        }
-
-    //printf("...building ExTRSV program\n");
+    //Built once per set of options, then taken from the cache
         char compileOptionsBak[256];
         sprintf(compileOptionsBak, "%s -DNBFPE=%d -DN=%d", compileOptions, NbFPE % 10, n / BLOCK_SIZE);
-        ciErrNum = clBuildProgram(cpProgram, 0, NULL, compileOptionsBak, NULL, NULL);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("ciErrNum = %d\n", ciErrNum);
-            printf("Error in clBuildProgram, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-
-            // Determine the reason for the error
-            size_t log_size;
-            clGetProgramBuildInfo(cpProgram, cdDevice, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
-            char *log = (char *) malloc(log_size);
-            clGetProgramBuildInfo(cpProgram, cdDevice, CL_PROGRAM_BUILD_LOG, log_size, log, NULL);
-            printf("%s\n", log);
-
+        cpProgram = ExOCLProgram(*ocl, program_file, compileOptionsBak, &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             return EXIT_FAILURE;
-        }
 
     //printf("...creating ExTRSV kernels:\n");
         ckInit = clCreateKernel(cpProgram, TRSV_INIT, &ciErrNum);
@@ -142,23 +103,20 @@ extern "C" cl_int initExTRSV(
 
     //allocating internal buffer
         if ((NbFPE != 20) && (NbFPE < 30)){
-            d_Superaccs = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, n * THREADSY * bin_count * sizeof(cl_long), NULL, &ciErrNum);
+            d_Superaccs = ExOCLBuffer(*ocl, "ExTRSV.Superaccs", n * THREADSY * bin_count * sizeof(cl_long), &ciErrNum);
             if (ciErrNum != CL_SUCCESS) {
                 printf("Error in clCreateBuffer, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
                 return EXIT_FAILURE;
             }
         }
-        d_sync = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE, 2 * sizeof(cl_int), NULL, &ciErrNum);
+        d_sync = ExOCLBuffer(*ocl, "ExTRSV.sync", 2 * sizeof(cl_int), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
             printf("Error in clCreateBuffer, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             return EXIT_FAILURE;
         }
 
     //Save default command queue
-    cqDefaultCommandQue = cqParamCommandQue;
-
-    //Discard temp storage
-    free(cSources);
+    cqDefaultCommandQue = ocl->queue;
 
     return EXIT_SUCCESS;
 }
@@ -166,11 +124,9 @@ extern "C" cl_int initExTRSV(
 extern "C" void closeExTRSV(void){
     cl_int ciErrNum;
 
+    // The program and the buffers are kept by the OpenCL handle for the next calls
     ciErrNum = clReleaseKernel(ckInit);
-    if (d_Superaccs) {
-        ciErrNum |= clReleaseMemObject(d_Superaccs);
-        d_Superaccs = NULL;
-    }
+    d_Superaccs = NULL;
     if (ckTRSV) {
         ciErrNum |= clReleaseKernel(ckTRSV);
         ckTRSV = NULL;
@@ -187,7 +143,6 @@ extern "C" void closeExTRSV(void){
         ciErrNum |= clReleaseKernel(ckAXPY);
         ckAXPY = NULL;
     }
-    ciErrNum |= clReleaseProgram(cpProgram);
 
     if (ciErrNum != CL_SUCCESS) {
         printf("Error in closeExTRSV(), Line %u in file %s !!!\n\n", __LINE__, __FILE__);
@@ -126,65 +126,53 @@ int extrsv(const char uplo, const char transa, const char diag, const int n, dou
 int runExTRSV(const int n, double *a, const int lda, const int offseta, double *x, const int incx, const int offsetx, const int fpe, const char* program_file) {
     cl_int ciErrNum;
 
-    //printf("Initializing OpenCL...\n");
-        char platform_name[64];
-#ifdef AMD
-        strcpy(platform_name, "AMD Accelerated Parallel Processing");
-#else
-        strcpy(platform_name, "NVIDIA CUDA");
-#endif
-        cl_platform_id cpPlatform = GetOCLPlatform(platform_name);
-        if (cpPlatform == NULL) {
-            printf("ERROR: Failed to find the platform '%s' ...\n", platform_name);
+    //Initializing OpenCL, once per process; the calls of several threads run one at a time
+        std::lock_guard<std::mutex> lock(ExOCLMutex());
+        ExOCLHandle *ocl = ExOCL();
+        if (ocl == NULL)
             return -1;
-        }
+        cl_command_queue cqCommandQueue = ocl->queue;
 
-        //Get a GPU device
-        cl_device_id cdDevice = GetOCLDevice(cpPlatform);
-        if (cdDevice == NULL) {
-            printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            return -1;
-        }
-
-        //Create the context
-        cl_context cxGPUContext = clCreateContext(0, 1, &cdDevice, NULL, NULL, &ciErrNum);
+        //Copying the inputs into the scratch buffers
+        cl_mem d_a = ExOCLBuffer(*ocl, "ExTRSV.a", n * n * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateContext, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Create a command-queue
-        cl_command_queue cqCommandQueue = clCreateCommandQueue(cxGPUContext, cdDevice, CL_QUEUE_PROFILING_ENABLE, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_a, CL_FALSE, 0, n * n * sizeof(cl_double), a, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateCommandQueue, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Allocating OpenCL memory...
-        cl_mem d_a = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, n * n * sizeof(cl_double), a, &ciErrNum);
+        cl_mem d_x = ExOCLBuffer(*ocl, "ExTRSV.x", n * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_x, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_x = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, n * sizeof(cl_double), x, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_x, CL_FALSE, 0, n * sizeof(cl_double), x, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_x, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_x, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
         cl_mem d_b;
         if (fpe >= 10) {
             // for IR case
-            d_b = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, n * sizeof(cl_double), x, &ciErrNum);
+            d_b = ExOCLBuffer(*ocl, "ExTRSV.b", n * sizeof(cl_double), &ciErrNum);
             if (ciErrNum != CL_SUCCESS) {
                 printf("Error in clCreateBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
                 exit(EXIT_FAILURE);
             }
+            ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_b, CL_FALSE, 0, n * sizeof(cl_double), x, 0, NULL, NULL);
+            if (ciErrNum != CL_SUCCESS) {
+                printf("Error in clEnqueueWriteBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+                exit(EXIT_FAILURE);
+            }
         }
 
 
     {
         //Initializing OpenCL dSum...
-        ciErrNum = initExTRSV(cxGPUContext, cqCommandQueue, cdDevice, program_file, n, fpe);
+        ciErrNum = initExTRSV(ocl, program_file, n, fpe);
         if (ciErrNum != CL_SUCCESS)
             exit(EXIT_FAILURE);
 
@@ -258,15 +246,8 @@ int runExTRSV(const int n, double *a, const int lda, const int offseta, double *
                 exit(EXIT_FAILURE);
             }
 
-         //Release kernels and program
-         //Shutting down and freeing memory...
+         //Release kernels; the context, programs and buffers are kept for the next calls
             closeExTRSV();
-            clReleaseMemObject(d_a);
-            clReleaseMemObject(d_x);
-            //if(fpe == 1)
-            //    clReleaseMemObject(d_b);
-            clReleaseCommandQueue(cqCommandQueue);
-            clReleaseContext(cxGPUContext);
     }
 
     return EXIT_SUCCESS;
@@ -16,9 +16,6 @@
   #define BLOCK_SIZE 32
 #endif
 
-static size_t szKernelLength;                 // Byte size of kernel code
-static char* cSources = NULL;                 // Buffer to hold source for compilation
-
 static cl_program       cpProgram;            //OpenCL Superaccumulator program
 static cl_kernel        ckMatrixMul;
 static cl_command_queue cqDefaultCommandQue;  //Default command queue for Superaccumulator
@@ -34,49 +31,18 @@ static char  compileOptions[256] = "-DBLOCK_SIZE=32 -DUSE_KNUTH -DNVIDIA -cl-mad
 // GPU related functions
 ////////////////////////////////////////////////////////////////////////////////
 extern "C" cl_int initExGEMM(
-    cl_context cxGPUContext,
-    cl_command_queue cqParamCommandQue,
-    cl_device_id cdDevice,
+    ExOCLHandle *ocl,
     const char* program_file,
     const uint NbFPE
 ){
     cl_int ciErrNum;
 
-    // Read the OpenCL kernel in from source file
-    FILE *program_handle;
-    program_handle = fopen(program_file, "r");
-    if (!program_handle) {
-        fprintf(stderr, "Failed to load kernel.\n");
-        exit(1);
-    }
-    fseek(program_handle, 0, SEEK_END);
-    szKernelLength = ftell(program_handle);
-    rewind(program_handle);
-    cSources = (char *) malloc(szKernelLength + 1);
-    cSources[szKernelLength] = '\0';
-    ciErrNum = fread(cSources, sizeof(char), szKernelLength, program_handle);
-    fclose(program_handle);
-
-    //printf("clCreateProgramWithSource...\n"); 
-        cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cSources, &szKernelLength, &ciErrNum);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateProgramWithSource, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    //Built once per set of options, then taken from the cache
+        char options[sizeof(compileOptions) + 32];
+        sprintf(options, "%s -DNBFPE=%d", compileOptions, NbFPE);
+        cpProgram = ExOCLProgram(*ocl, program_file, options, &ciErrNum);
+        if (ciErrNum != CL_SUCCESS)
             return EXIT_FAILURE;
-        }
-
-    //printf("...building program\n");
-        sprintf(compileOptions, "%s -DNBFPE=%d", compileOptions, NbFPE);
-        ciErrNum = clBuildProgram(cpProgram, 0, NULL, compileOptions, NULL, NULL);
-        if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clBuildProgram, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-
-            // Determine the reason for the error
-            char buildLog[4096]; // 16384
-            clGetProgramBuildInfo(cpProgram, cdDevice, CL_PROGRAM_BUILD_LOG, sizeof(buildLog), &buildLog, NULL);
-            printf("%s\n", buildLog);
-
-            return EXIT_FAILURE;
-        }
 
     //printf("...creating DGEMM kernel:\n");
         ckMatrixMul = clCreateKernel(cpProgram, DGEMM_KERNEL, &ciErrNum);
@@ -86,10 +52,7 @@ extern "C" cl_int initExGEMM(
         }
 
     //Save default command queue
-    cqDefaultCommandQue = cqParamCommandQue;
-
-    //Discard temp storage
-    free(cSources);
+    cqDefaultCommandQue = ocl->queue;
 
     return EXIT_SUCCESS;
 }
@@ -97,8 +60,8 @@ extern "C" cl_int initExGEMM(
 extern "C" void closeExGEMM(void){
     cl_int ciErrNum;
 
+    // The program is kept by the OpenCL handle for the next calls
     ciErrNum = clReleaseKernel(ckMatrixMul);
-    ciErrNum |= clReleaseProgram(cpProgram);
     if (ciErrNum != CL_SUCCESS) {
         printf("Error in closeDGEMM(), Line %u in file %s !!!\n\n", __LINE__, __FILE__);
     }
@@ -101,61 +101,48 @@ int exgemm(char transa, char transb, int m, int n, int k, double alpha, double *
 static int runExGEMM(int m, int n, int k, double alpha, double *h_a, int lda, double *h_b, int ldb, double beta, double *h_c, int ldc, int fpe, const char* program_file) {
     cl_int ciErrNum;
 
-    //printf("Initializing OpenCL...\n");
-        char platform_name[64];
-#ifdef AMD
-        strcpy(platform_name, "AMD Accelerated Parallel Processing");
-#else
-        strcpy(platform_name, "NVIDIA CUDA");
-#endif
-        cl_platform_id cpPlatform = GetOCLPlatform(platform_name);
-        if (cpPlatform == NULL) {
-            printf("ERROR: Failed to find the platform '%s' ...\n", platform_name);
+    //Initializing OpenCL, once per process; the calls of several threads run one at a time
+        std::lock_guard<std::mutex> lock(ExOCLMutex());
+        ExOCLHandle *ocl = ExOCL();
+        if (ocl == NULL)
             return -1;
-        }
+        cl_command_queue cqCommandQueue = ocl->queue;
 
-        //Get a GPU device
-        cl_device_id cdDevice = GetOCLDevice(cpPlatform);
-        if (cdDevice == NULL) {
-            printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
-            return -1;
-        }
-
-        //Create the context
-        cl_context cxGPUContext = clCreateContext(0, 1, &cdDevice, NULL, NULL, &ciErrNum);
+        //Copying the inputs into the scratch buffers
+        cl_mem d_a = ExOCLBuffer(*ocl, "ExGEMM.a", m * k * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateContext, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Create a command-queue
-        cl_command_queue cqCommandQueue = clCreateCommandQueue(cxGPUContext, cdDevice, CL_QUEUE_PROFILING_ENABLE, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_a, CL_FALSE, 0, m * k * sizeof(cl_double), h_a, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateCommandQueue, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-
-        //Allocating OpenCL memory...
-        cl_mem d_a = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m * k * sizeof(cl_double), h_a, &ciErrNum);
+        cl_mem d_b = ExOCLBuffer(*ocl, "ExGEMM.b", k * n * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_a, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clCreateBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_b = clCreateBuffer(cxGPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, k * n * sizeof(cl_double), h_b, &ciErrNum);
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_b, CL_FALSE, 0, k * n * sizeof(cl_double), h_b, 0, NULL, NULL);
         if (ciErrNum != CL_SUCCESS) {
-            printf("Error in clCreateBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            printf("Error in clEnqueueWriteBuffer for d_b, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
-        cl_mem d_c = clCreateBuffer(cxGPUContext, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, m * n * sizeof(cl_double), h_c, &ciErrNum);
-        //cl_mem d_c = clCreateBuffer(cxGPUContext, CL_MEM_WRITE_ONLY, m * n * sizeof(cl_double), h_c, &ciErrNum);
+        cl_mem d_c = ExOCLBuffer(*ocl, "ExGEMM.c", m * n * sizeof(cl_double), &ciErrNum);
         if (ciErrNum != CL_SUCCESS) {
             printf("Error in clCreateBuffer for d_c, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
             exit(EXIT_FAILURE);
         }
+        ciErrNum = clEnqueueWriteBuffer(cqCommandQueue, d_c, CL_FALSE, 0, m * n * sizeof(cl_double), h_c, 0, NULL, NULL);
+        if (ciErrNum != CL_SUCCESS) {
+            printf("Error in clEnqueueWriteBuffer for d_c, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+            exit(EXIT_FAILURE);
+        }
 
     {
         //Initializing OpenCL ExGEMM...
-            ciErrNum = initExGEMM(cxGPUContext, cqCommandQueue, cdDevice, program_file, fpe);
+            ciErrNum = initExGEMM(ocl, program_file, fpe);
             if (ciErrNum != CL_SUCCESS)
                 exit(EXIT_FAILURE);
 
@@ -212,19 +199,8 @@ static int runExGEMM(int m, int n, int k, double alpha, double *h_a, int lda, do
                 exit(EXIT_FAILURE);
             }
 
-         //Release kernels and program
-         //Shutting down and freeing memory...
+         //Release kernels; the context, programs and buffers are kept for the next calls
             closeExGEMM();
-            if(d_a)
-                clReleaseMemObject(d_a);
-            if(d_b)
-                clReleaseMemObject(d_b);
-            if(d_c)
-                clReleaseMemObject(d_c);
-            if(cqCommandQueue)
-                clReleaseCommandQueue(cqCommandQueue);
-            if(cxGPUContext)
-                clReleaseContext(cxGPUContext);
     }
 
     return EXIT_SUCCESS;
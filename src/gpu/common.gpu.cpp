@@ -3,6 +3,11 @@
  *  All rights reserved.
  */
 
+#include <cerrno>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "common.gpu.hpp"
 
 
@@ -45,6 +50,9 @@ cl_device_id GetOCLDevice(cl_platform_id pPlatform) {
 
   cl_uint uiNumDevices = 0;
   cl_int err = clGetDeviceIDs(pPlatform, CL_DEVICE_TYPE_GPU, 10, dDevices, &uiNumDevices);
+  // Platforms without GPUs, such as POCL, run the kernels on their other devices
+  if (err == CL_DEVICE_NOT_FOUND)
+    err = clGetDeviceIDs(pPlatform, CL_DEVICE_TYPE_ALL, 10, dDevices, &uiNumDevices);
   if (err != CL_SUCCESS) {
         printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
 	exit(0);
@@ -95,3 +103,272 @@ cl_device_id GetOCLDevice(cl_platform_id pPlatform, char name[]) {
 }
 #endif
 
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenCL objects kept from one call to another
+////////////////////////////////////////////////////////////////////////////////
+static ExOCLHandle *ocl = NULL;
+static std::mutex ocl_mutex;
+
+std::mutex &ExOCLMutex(void) {
+  return ocl_mutex;
+}
+
+ExOCLHandle *ExOCL(void) {
+  if (ocl)
+    return ocl;
+
+  char platform_name[128];
+  const char *env = getenv("EXBLAS_OPENCL_PLATFORM");
+  if (env) {
+    strncpy(platform_name, env, sizeof(platform_name) - 1);
+    platform_name[sizeof(platform_name) - 1] = '\0';
+  } else {
+#ifdef AMD
+    strcpy(platform_name, "AMD Accelerated Parallel Processing");
+#else
+    strcpy(platform_name, "NVIDIA CUDA");
+#endif
+  }
+  cl_platform_id cpPlatform = GetOCLPlatform(platform_name);
+  if (cpPlatform == NULL) {
+    printf("ERROR: Failed to find the platform '%s' ...\n", platform_name);
+    return NULL;
+  }
+
+  //Get a GPU device
+  cl_device_id cdDevice = GetOCLDevice(cpPlatform);
+  if (cdDevice == NULL) {
+    printf("Error in clGetDeviceIDs, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    return NULL;
+  }
+
+  //Create the context
+  cl_int ciErrNum;
+  cl_context cxGPUContext = clCreateContext(0, 1, &cdDevice, NULL, NULL, &ciErrNum);
+  if (ciErrNum != CL_SUCCESS) {
+    printf("Error in clCreateContext, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    exit(EXIT_FAILURE);
+  }
+
+  //Create a command-queue
+  cl_command_queue cqCommandQueue = clCreateCommandQueue(cxGPUContext, cdDevice, CL_QUEUE_PROFILING_ENABLE, &ciErrNum);
+  if (ciErrNum != CL_SUCCESS) {
+    printf("Error in clCreateCommandQueue, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    exit(EXIT_FAILURE);
+  }
+
+  ocl = new ExOCLHandle;
+  ocl->platform = cpPlatform;
+  ocl->device = cdDevice;
+  ocl->context = cxGPUContext;
+  ocl->queue = cqCommandQueue;
+  return ocl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Binaries of the programs kept on disk from one run to another
+////////////////////////////////////////////////////////////////////////////////
+// FNV-1a hash of the given bytes
+static unsigned long long ExOCLHash(const std::string &bytes) {
+  unsigned long long h = 14695981039346656037ULL;
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    h ^= (unsigned char) bytes[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static std::string ExOCLDeviceInfo(cl_device_id device, cl_device_info param) {
+  char value[256] = { 0 };
+  if (clGetDeviceInfo(device, param, sizeof(value) - 1, value, NULL) != CL_SUCCESS)
+    return "";
+  return value;
+}
+
+/*
+ * Returns the directory of the binaries, created if needed: the one named by EXBLAS_OPENCL_CACHE,
+ * otherwise exblas in the cache directory of the user. It is empty when the cache is disabled,
+ * with EXBLAS_OPENCL_CACHE set to an empty string, or cannot be created
+ */
+static std::string ExOCLCacheDir(void) {
+  std::string dir;
+  const char *env = getenv("EXBLAS_OPENCL_CACHE");
+  if (env)
+    dir = env;
+  else if (getenv("XDG_CACHE_HOME") && *getenv("XDG_CACHE_HOME"))
+    dir = std::string(getenv("XDG_CACHE_HOME")) + "/exblas";
+  else if (getenv("HOME") && *getenv("HOME"))
+    dir = std::string(getenv("HOME")) + "/.cache/exblas";
+
+  for (size_t pos = 1; !dir.empty() && (pos <= dir.size()); ++pos) {
+    if ((pos == dir.size()) || (dir[pos] == '/')) {
+      if ((mkdir(dir.substr(0, pos).c_str(), 0755) != 0) && (errno != EEXIST))
+        return "";
+    }
+  }
+  return dir;
+}
+
+/*
+ * Returns the program stored in file for the given identity, built for the device of ocl,
+ * or NULL when the file is missing, belongs to another identity, or does not build
+ */
+static cl_program ExOCLLoadBinary(ExOCLHandle &ocl, const std::string &file, const std::string &identity, const char *options) {
+  FILE *handle = fopen(file.c_str(), "rb");
+  if (!handle)
+    return NULL;
+  fseek(handle, 0, SEEK_END);
+  long length = ftell(handle);
+  rewind(handle);
+  std::string content(length > 0 ? length : 0, '\0');
+  size_t read = fread(&content[0], sizeof(char), content.size(), handle);
+  fclose(handle);
+
+  // The identity, then a null character, then the binary
+  size_t header = identity.size() + 1;
+  if ((read != content.size()) || (content.size() <= header) || content.compare(0, identity.size(), identity) || content[identity.size()])
+    return NULL;
+
+  size_t szBinaryLength = content.size() - header;
+  const unsigned char *binary = (const unsigned char *) &content[header];
+  cl_int ciBinaryStatus, ciErrNum;
+  cl_program cpProgram = clCreateProgramWithBinary(ocl.context, 1, &ocl.device, &szBinaryLength, &binary, &ciBinaryStatus, &ciErrNum);
+  if ((ciErrNum != CL_SUCCESS) || (ciBinaryStatus != CL_SUCCESS))
+    return NULL;
+  if (clBuildProgram(cpProgram, 0, NULL, options, NULL, NULL) != CL_SUCCESS) {
+    clReleaseProgram(cpProgram);
+    return NULL;
+  }
+  return cpProgram;
+}
+
+/*
+ * Stores the binary of the built program in file for the given identity. The file is written
+ * under another name first, so that concurrent jobs only ever read complete files. That name is
+ * made unique by mkstemp, as jobs of several hosts sharing the directory may have the same pid
+ */
+static void ExOCLStoreBinary(cl_program cpProgram, const std::string &file, const std::string &identity) {
+  size_t szBinaryLength = 0;
+  if ((clGetProgramInfo(cpProgram, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &szBinaryLength, NULL) != CL_SUCCESS) || (szBinaryLength == 0))
+    return;
+  std::vector<unsigned char> binary(szBinaryLength);
+  unsigned char *binaries = &binary[0];
+  if (clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, sizeof(unsigned char *), &binaries, NULL) != CL_SUCCESS)
+    return;
+
+  std::string temporary = file + ".XXXXXX";
+  int descriptor = mkstemp(&temporary[0]);
+  if (descriptor < 0)
+    return;
+  FILE *handle = (fchmod(descriptor, 0644) == 0) ? fdopen(descriptor, "wb") : NULL;
+  if (!handle) {
+    close(descriptor);
+    remove(temporary.c_str());
+    return;
+  }
+  bool written = (fwrite(identity.c_str(), sizeof(char), identity.size() + 1, handle) == identity.size() + 1)
+      && (fwrite(binaries, sizeof(unsigned char), szBinaryLength, handle) == szBinaryLength);
+  written &= (fclose(handle) == 0);
+  if (!written || (rename(temporary.c_str(), file.c_str()) != 0))
+    remove(temporary.c_str());
+}
+
+cl_program ExOCLProgram(ExOCLHandle &ocl, const char *program_file, const char *options, cl_int *ciErrNum) {
+  std::string key = std::string(program_file) + '\n' + options;
+  std::map<std::string, cl_program>::iterator it = ocl.programs.find(key);
+  if (it != ocl.programs.end()) {
+    *ciErrNum = CL_SUCCESS;
+    return it->second;
+  }
+
+  // Read the OpenCL kernel in from source file
+  FILE *program_handle = fopen(program_file, "r");
+  if (!program_handle) {
+    fprintf(stderr, "Failed to load kernel.\n");
+    exit(1);
+  }
+  fseek(program_handle, 0, SEEK_END);
+  size_t szKernelLength = ftell(program_handle);
+  rewind(program_handle);
+  std::string cSources(szKernelLength, '\0');
+  szKernelLength = fread(&cSources[0], sizeof(char), szKernelLength, program_handle);
+  fclose(program_handle);
+  cSources.resize(szKernelLength);
+
+  // The binary built by an earlier run is used if it comes from the same device, driver, source and options
+  char hash[32];
+  sprintf(hash, "%016llx", ExOCLHash(cSources));
+  std::string identity = "ExBLAS OpenCL binary\n" + ExOCLDeviceInfo(ocl.device, CL_DEVICE_NAME) + '\n'
+      + ExOCLDeviceInfo(ocl.device, CL_DRIVER_VERSION) + '\n' + hash + '\n' + options;
+  std::string cache = ExOCLCacheDir();
+  if (!cache.empty()) {
+    sprintf(hash, "/%016llx.bin", ExOCLHash(identity));
+    cache += hash;
+  }
+
+  cl_program cpProgram = cache.empty() ? NULL : ExOCLLoadBinary(ocl, cache, identity, options);
+  if (cpProgram) {
+    *ciErrNum = CL_SUCCESS;
+    ocl.programs[key] = cpProgram;
+    return cpProgram;
+  }
+
+  const char *source = cSources.c_str();
+  cpProgram = clCreateProgramWithSource(ocl.context, 1, &source, &szKernelLength, ciErrNum);
+  if (*ciErrNum != CL_SUCCESS) {
+    printf("Error in clCreateProgramWithSource, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+    return NULL;
+  }
+
+  *ciErrNum = clBuildProgram(cpProgram, 0, NULL, options, NULL, NULL);
+  if (*ciErrNum != CL_SUCCESS) {
+    printf("Error in clBuildProgram, Line %u in file %s !!!\n\n", __LINE__, __FILE__);
+
+    // Determine the reason for the error
+    char buildLog[16384];
+    clGetProgramBuildInfo(cpProgram, ocl.device, CL_PROGRAM_BUILD_LOG, sizeof(buildLog), &buildLog, NULL);
+    printf("%s\n", buildLog);
+    clReleaseProgram(cpProgram);
+
+    return NULL;
+  }
+
+  if (!cache.empty())
+    ExOCLStoreBinary(cpProgram, cache, identity);
+  ocl.programs[key] = cpProgram;
+  return cpProgram;
+}
+
+cl_mem ExOCLBuffer(ExOCLHandle &ocl, const char *name, size_t size, cl_int *ciErrNum) {
+  std::pair<cl_mem, size_t> &buffer = ocl.buffers[name];
+  *ciErrNum = CL_SUCCESS;
+  if (buffer.first && (buffer.second >= size))
+    return buffer.first;
+
+  if (buffer.first)
+    clReleaseMemObject(buffer.first);
+  buffer.first = clCreateBuffer(ocl.context, CL_MEM_READ_WRITE, size, NULL, ciErrNum);
+  buffer.second = (*ciErrNum == CL_SUCCESS) ? size : 0;
+  if (*ciErrNum != CL_SUCCESS) {
+    printf("Error in clCreateBuffer for %s, Line %u in file %s !!!\n\n", name, __LINE__, __FILE__);
+    buffer.first = NULL;
+  }
+  return buffer.first;
+}
+
+void ExOCLRelease(void) {
+  std::lock_guard<std::mutex> lock(ocl_mutex);
+  if (!ocl)
+    return;
+
+  for (std::map<std::string, std::pair<cl_mem, size_t> >::iterator it = ocl->buffers.begin(); it != ocl->buffers.end(); ++it)
+    if (it->second.first)
+      clReleaseMemObject(it->second.first);
+  for (std::map<std::string, cl_program>::iterator it = ocl->programs.begin(); it != ocl->programs.end(); ++it)
+    clReleaseProgram(it->second);
+  clReleaseCommandQueue(ocl->queue);
+  clReleaseContext(ocl->context);
+  delete ocl;
+  ocl = NULL;
+}
@@ -21,6 +21,9 @@
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
 
 // All OpenCL headers
 #if defined (__APPLE__) || defined(MACOSX)
@@ -71,4 +74,89 @@ cl_device_id GetOCLDevice(
 );
 #endif
 
+
+/**
+ * \ingroup ExSUM
+ * \brief OpenCL objects kept from one call of the routines to another, so that repeated
+ *     calls only transfer their data and enqueue their kernels. They are shared by all the
+ *     threads, and used under the lock of ExOCLMutex only. For internal use
+ */
+struct ExOCLHandle {
+    cl_platform_id platform; /**< platform of the device */
+    cl_device_id device; /**< device running the kernels */
+    cl_context context; /**< context of the device */
+    cl_command_queue queue; /**< command queue of the device */
+    std::map<std::string, cl_program> programs; /**< programs built from each file with each set of options */
+    std::map<std::string, std::pair<cl_mem, size_t> > buffers; /**< scratch buffers and their sizes, by name */
+};
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the mutex guarding the OpenCL objects of the process. The routines hold it
+ *     from their call of ExOCL to the reading of their result, so that the calls of several
+ *     threads run one after another on the scratch buffers and kernels. For internal use
+ */
+std::mutex & ExOCLMutex(
+    void
+);
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the OpenCL objects of the process, created at the first call, with the lock
+ *     of ExOCLMutex held. The platform is
+ *     the one named by the EXBLAS_OPENCL_PLATFORM environment variable, such as "Portable Computing
+ *     Language" for POCL, otherwise the one of the vendor the library is built for. For internal use
+ *
+ * \return OpenCL objects, or NULL when the platform or its device is not found
+ */
+ExOCLHandle * ExOCL(
+    void
+);
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the program built from the given file with the given options, read and
+ *     built at the first call only. Its binary is kept on disk and reused by the next runs
+ *     on the same device and driver, as long as the file and the options are unchanged. For internal use
+ *
+ * \param ocl OpenCL objects
+ * \param program_file path to the file with kernels
+ * \param options compile options
+ * \param ciErrNum Error number (output)
+ * \return Program, owned by ocl
+ */
+cl_program ExOCLProgram(
+    ExOCLHandle & ocl,
+    const char* program_file,
+    const char* options,
+    cl_int *ciErrNum
+);
+
+/**
+ * \ingroup ExSUM
+ * \brief Returns the scratch buffer of the given name, of at least size bytes. It is reallocated
+ *     only when it grows, so its content does not outlive the call using it. For internal use
+ *
+ * \param ocl OpenCL objects
+ * \param name name of the buffer, unique to its use
+ * \param size size in bytes
+ * \param ciErrNum Error number (output)
+ * \return Buffer, owned by ocl
+ */
+cl_mem ExOCLBuffer(
+    ExOCLHandle & ocl,
+    const char* name,
+    size_t size,
+    cl_int *ciErrNum
+);
+
+/**
+ * \ingroup ExSUM
+ * \brief Releases the OpenCL objects of the process, which the next call creates again.
+ *     It takes the lock of ExOCLMutex, so it waits for the call in progress, if any
+ */
+void ExOCLRelease(
+    void
+);
+
 #endif // COMMON_GPU_HPP_
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/*
+ * Measures the time per call of exsum with static and dynamic scheduling under load imbalance:
+ * background threads spin on some of the cores, so that the threads of exsum sharing these cores
+ * run slower than the others, as on cores of different speeds or on shared machines
+ *
+ * Usage: bench.exsum.imbalance [log2(N) ...]
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <mm_malloc.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// exblas
+#include "blas1.hpp"
+#include "common.hpp"
+
+
+static int const repetitions = 20;
+
+static double bench(exblas::Context & ctx, int N, double *a, int fpe, double & res) {
+    double mint = 1e100;
+    for (int r = 0; r != repetitions; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        res = exsum(ctx, N, a, 1, 0, fpe);
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        mint = t < mint ? t : mint;
+    }
+    return mint;
+}
+
+int main(int argc, char * argv[]) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if (sizes.empty()) {
+        sizes.push_back(20);
+        sizes.push_back(24);
+    }
+
+    int ncores = std::thread::hardware_concurrency();
+    exblas::Context ctx_static(ncores);
+    exblas::Context ctx_dynamic(ncores);
+    ctx_dynamic.set_schedule(exblas::ScheduleDynamic);
+
+    // Numbers of background threads spinning while exsum runs
+    std::vector<int> loads;
+    loads.push_back(0);
+    loads.push_back(1);
+    if (ncores > 2)
+        loads.push_back(ncores / 2);
+
+    bool is_pass = true;
+    printf("N,fpe,spinning_threads,us_per_call_static,us_per_call_dynamic\n");
+    for (size_t s = 0; s != sizes.size(); ++s) {
+        int N = 1 << sizes[s];
+        double *a = (double*)_mm_malloc(N * sizeof(double), 32);
+        if (!a) {
+            fprintf(stderr, "Cannot allocate memory for the main array\n");
+            exit(1);
+        }
+        init_fpuniform(N, a, 50, 0);
+
+        for (size_t l = 0; l != loads.size(); ++l) {
+            std::atomic<bool> stop(false);
+            std::vector<std::thread> spinners;
+            for (int k = 0; k != loads[l]; ++k)
+                spinners.push_back(std::thread([&stop] {
+                    while (!stop.load(std::memory_order_relaxed))
+                        ;
+                }));
+
+            int fpes[] = {0, 4, 8};
+            for (int f = 0; f != 3; ++f) {
+                double res1, res2;
+                double t1 = bench(ctx_static, N, a, fpes[f], res1);
+                double t2 = bench(ctx_dynamic, N, a, fpes[f], res2);
+                printf("%d,%d,%d,%f,%f\n", N, fpes[f], loads[l], t1 * 1e6, t2 * 1e6);
+                is_pass &= (res1 == res2);
+            }
+
+            stop = true;
+            for (size_t k = 0; k != spinners.size(); ++k)
+                spinners[k].join();
+        }
+        _mm_free(a);
+    }
+
+    if (!is_pass)
+        printf("Results differ between static and dynamic scheduling!\n");
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/*
+ * Measures the time per call of exsum when the cores are oversubscribed: the routines
+ * run within a context with twice as many threads as available cores, and the timings
+ * are compared against a context with one thread per core
+ *
+ * Usage: bench.exsum.oversubscription [log2(N) ...]
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <mm_malloc.h>
+#include <chrono>
+#include <thread>
+
+// exblas
+#include "blas1.hpp"
+#include "common.hpp"
+
+
+static int const repetitions = 100;
+
+static double bench(exblas::Context & ctx, int N, double *a, int fpe, double & res) {
+    double mint = 1e100;
+    for (int r = 0; r != repetitions; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        res = exsum(ctx, N, a, 1, 0, fpe);
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        mint = t < mint ? t : mint;
+    }
+    return mint;
+}
+
+int main(int argc, char * argv[]) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if (sizes.empty()) {
+        sizes.push_back(10);
+        sizes.push_back(14);
+        sizes.push_back(17);
+        sizes.push_back(20);
+    }
+
+    int ncores = std::thread::hardware_concurrency();
+    exblas::Context ctx1(ncores);
+    exblas::Context ctx2(2 * ncores);
+
+    bool is_pass = true;
+    printf("N,fpe,us_per_call_%dthreads,us_per_call_%dthreads\n", ncores, 2 * ncores);
+    for (size_t s = 0; s != sizes.size(); ++s) {
+        int N = 1 << sizes[s];
+        double *a = (double*)_mm_malloc(N * sizeof(double), 32);
+        if (!a) {
+            fprintf(stderr, "Cannot allocate memory for the main array\n");
+            exit(1);
+        }
+        init_fpuniform(N, a, 50, 0);
+
+        int fpes[] = {0, 4, 8};
+        for (int f = 0; f != 3; ++f) {
+            double res1, res2;
+            double t1 = bench(ctx1, N, a, fpes[f], res1);
+            double t2 = bench(ctx2, N, a, fpes[f], res2);
+            printf("%d,%d,%f,%f\n", N, fpes[f], t1 * 1e6, t2 * 1e6);
+            is_pass &= (res1 == res2);
+        }
+        _mm_free(a);
+    }
+
+    if (!is_pass)
+        printf("Results differ with oversubscription!\n");
+
+    return 0;
+}
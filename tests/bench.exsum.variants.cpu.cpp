@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+/*
+ * Sweeps all the variants of floating-point expansions (see ExFPEOptions) across
+ * vector sizes, expansion sizes, and data distributions. Prints one CSV line per run
+ * and, for each workload class, the fastest variant that reproduces the result obtained
+ * with superaccumulators only
+ *
+ * Usage: bench.exsum.variants [log2(N) ...]
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <mm_malloc.h>
+#include <chrono>
+
+// exblas
+#include "blas1.hpp"
+#include "common.hpp"
+
+
+static int const repetitions = 5;
+
+static const char * const generators[] = {"naive", "fpuniform", "lognormal", "ill_cond"};
+
+static void init(int gen, int N, double *a) {
+    switch (gen) {
+        case 0: init_naive(N, a); break;
+        case 1: init_fpuniform(N, a, 50, 0); break;
+        case 2: init_lognormal(N, a, 1., 2.); break;
+        case 3: init_ill_cond(N, a, 1e+50); break;
+    }
+}
+
+static ExFPEOptions options(int variant) {
+    ExFPEOptions opts;
+    opts.early_exit = variant & 1;
+    opts.flush_hi = variant & 2;
+    opts.horz_2sum = variant & 4;
+    opts.check_range_first = variant & 8;
+    opts.conditional_swap = variant & 16;
+    opts.biased_2sum = variant & 32;
+    opts.sort = variant & 64;
+    opts.victim_cache = variant & 128;
+    return opts;
+}
+
+int main(int argc, char * argv[]) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if (sizes.empty()) {
+        sizes.push_back(12);
+        sizes.push_back(16);
+        sizes.push_back(20);
+    }
+
+    printf("generator,N,fpe,early_exit,flush_hi,horz_2sum,check_range_first,conditional_swap,biased_2sum,sort,victim_cache,ns_per_element,reproducible\n");
+    for (int gen = 0; gen != 4; ++gen) {
+        for (size_t s = 0; s != sizes.size(); ++s) {
+            int N = 1 << sizes[s];
+            double *a = (double*)_mm_malloc(N * sizeof(double), 32);
+            if (!a) {
+                fprintf(stderr, "Cannot allocate memory for the main array\n");
+                exit(1);
+            }
+            init(gen, N, a);
+            double ref = exsum(N, a, 1, 0, 0);
+
+            double best = 1e100;
+            int best_fpe = 0, best_variant = 0;
+            for (int fpe = 2; fpe <= 8; ++fpe) {
+                for (int variant = 0; variant != 256; ++variant) {
+                    ExFPEOptions opts = options(variant);
+                    double res = 0., mint = 1e100;
+                    for (int r = 0; r != repetitions; ++r) {
+                        auto t0 = std::chrono::steady_clock::now();
+                        res = exsum(N, a, 1, 0, fpe, opts);
+                        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                        mint = t < mint ? t : mint;
+                    }
+                    double nspe = mint * 1e9 / N;
+                    bool ok = (res == ref);
+                    printf("%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%f,%d\n", generators[gen], N, fpe,
+                        opts.early_exit, opts.flush_hi, opts.horz_2sum, opts.check_range_first,
+                        opts.conditional_swap, opts.biased_2sum, opts.sort, opts.victim_cache, nspe, ok);
+                    if (ok && nspe < best) {
+                        best = nspe;
+                        best_fpe = fpe;
+                        best_variant = variant;
+                    }
+                }
+            }
+            fprintf(stderr, "%s N=%d: fastest fpe=%d variant=0x%02x (%f ns per element)\n",
+                generators[gen], N, best_fpe, best_variant, best);
+            _mm_free(a);
+        }
+    }
+
+    return 0;
+}
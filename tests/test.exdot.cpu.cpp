@@ -0,0 +1,416 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie 
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <mm_malloc.h>
+#include <thread>
+#include <vector>
+
+#ifdef EXBLAS_MPI
+    #include <mpi.h>
+#endif
+
+// exblas
+#include "blas1.hpp"
+#include "common.hpp"
+
+#ifdef EXBLAS_VS_MPFR
+#include <cstddef>
+#include <mpfr.h>
+
+double ExDOTVsMPFR(int N, double *a, int inca, double *b, int incb) {
+    mpfr_t sum, dot, op;
+    mpfr_init2(op, 64);
+    mpfr_init2(dot, 128);
+    mpfr_init2(sum, 4196);
+
+    mpfr_set_zero(dot, 0.0);
+    mpfr_set_zero(sum, 0.0);
+
+    for (int i = 0; i < N; i++) {
+        mpfr_set_d(op, a[i], MPFR_RNDN);
+        mpfr_mul_d(dot, op, b[i], MPFR_RNDN);
+        mpfr_add(sum, sum, dot, MPFR_RNDN);
+    }
+    double dacc = mpfr_get_d(sum, MPFR_RNDN);
+
+    mpfr_clear(op);
+    mpfr_clear(dot);
+    mpfr_clear(sum);
+    mpfr_free_cache();
+
+    return dacc;
+}
+#endif
+
+
+int main(int argc, char *argv[]) {
+    double eps = 1e-16;
+    int N = 1 << 20;
+    bool lognormal = false;
+    if(argc > 1) {
+        N = 1 << atoi(argv[1]);
+    }
+    if(argc > 4) {
+        if(argv[4][0] == 'n') {
+            lognormal = true;
+        }
+    }
+
+    int range = 1;
+    int emax = 0;
+    double mean = 1., stddev = 1.;
+    if(lognormal) {
+        stddev = strtod(argv[2], 0);
+        mean = strtod(argv[3], 0);
+    }
+    else {
+        if(argc > 2) {
+            range = atoi(argv[2]);
+        }
+        if(argc > 3) {
+            emax = atoi(argv[3]);
+        }
+    }
+
+    double *a = NULL, *b = NULL;
+    float *af = NULL, *bf = NULL;
+    bool fits_float = true;
+#ifdef EXBLAS_MPI
+    int np = 1, p;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &p);
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+    if (p == 0) {
+#endif
+    a = (double*)_mm_malloc(N * sizeof(double), 32);
+    b = (double*)_mm_malloc(N * sizeof(double), 32);
+    af = (float*)_mm_malloc(N * sizeof(float), 32);
+    bf = (float*)_mm_malloc(N * sizeof(float), 32);
+    if ((!a) || (!b) || (!af) || (!bf))
+        fprintf(stderr, "Cannot allocate memory for the main array\n");
+    if(lognormal) {
+        init_lognormal(N, a, mean, stddev);
+        init_lognormal(N, b, mean, stddev);
+    } else if ((argc > 4) && (argv[4][0] == 'i')) {
+        init_ill_cond(N, a, range);
+        init_ill_cond(N, b, range);
+    } else {
+        if(range == 1){
+            init_naive(N, a);
+            init_naive(N, b);
+        } else {
+            init_fpuniform(N, a, range, emax);
+            init_fpuniform(N, b, range, emax);
+        }
+    }
+    for(int i = 0; i != N; ++i) {
+        af[i] = a[i];
+        bf[i] = b[i];
+        fits_float &= std::isfinite(af[i]) && std::isfinite(bf[i]);
+    }
+
+    fprintf(stderr, "%d ", N);
+
+    if(lognormal) {
+        fprintf(stderr, "%f ", stddev);
+    } else {
+        fprintf(stderr, "%d ", range);
+    }
+#ifdef EXBLAS_MPI
+    }
+#endif
+
+    bool is_pass = true;
+    double exdot_acc, exdot_fpe3, exdot_fpe4, exdot_fpe8, exdot_fpe4ee, exdot_fpe6ee, exdot_fpe8ee;
+    exdot_acc = exdot(N, a, 1, 0, b, 1, 0, 0);
+    exdot_fpe3 = exdot(N, a, 1, 0, b, 1, 0, 3);
+    exdot_fpe4 = exdot(N, a, 1, 0, b, 1, 0, 4);
+    exdot_fpe8 = exdot(N, a, 1, 0, b, 1, 0, 8);
+    exdot_fpe4ee = exdot(N, a, 1, 0, b, 1, 0, 4, true);
+    exdot_fpe6ee = exdot(N, a, 1, 0, b, 1, 0, 6, true);
+    exdot_fpe8ee = exdot(N, a, 1, 0, b, 1, 0, 8, true);
+    float exdotf_acc, exdotf_fpe3, exdotf_fpe4ee, exdotf_fpe8ee;
+    exdotf_acc = exdotf(N, af, 1, 0, bf, 1, 0, 0);
+    exdotf_fpe3 = exdotf(N, af, 1, 0, bf, 1, 0, 3);
+    exdotf_fpe4ee = exdotf(N, af, 1, 0, bf, 1, 0, 4, true);
+    exdotf_fpe8ee = exdotf(N, af, 1, 0, bf, 1, 0, 8, true);
+    // Strided vectors with offsets and increments of opposite signs, against contiguous copies.
+    // With MPI, the vectors of the root are scattered, and the results compared on the root
+    {
+        bool root = true;
+#ifdef EXBLAS_MPI
+        root = (p == 0);
+#endif
+        int M = (N - 1) / 3;
+        double *c = (double*)_mm_malloc(2 * M * sizeof(double), 32);
+        double *d = c + M;
+        for (int i = 0; root && (i != M); ++i) {
+            c[i] = a[1 + 3 * i];
+            d[i] = b[2 * (M - 1 - i)];
+        }
+        double ref = exdot(M, c, 1, 0, d, 1, 0, 0);
+        std::vector<double> strided = {exdot(M, a, 3, 1, b, -2, 0, 0), exdot(M, a, 3, 1, b, -2, 0, 4), exdot(M, a, -3, 1, b, 2, 0, 8, true),
+            exdot(M, c + 1, 1, -1, d, 1, 0, 4)};
+#ifndef EXBLAS_MPI
+        // With MPI, each process passes its own parts of the vectors to the 64-bit routines
+        strided.push_back(exdot_64(M, a, 3, 1, b, -2, 0, 0));
+        strided.push_back(exdot_64(M, a, -3, 1, b, 2, 0, 4));
+#endif
+        for (size_t i = 0; root && (i != strided.size()); ++i) {
+            if (strided[i] != ref) {
+                is_pass = false;
+                printf("FAILED: exdot with increments %.16g \t %.16g\n", strided[i], ref);
+            }
+        }
+        _mm_free(c);
+    }
+#ifndef EXBLAS_MPI
+    // Dot products of known rounding: the exact products of (1 + 2^-27)^2 put ties and sticky bits
+    // right below the last bit of 1 + 2^-26, and products by ones give cancellations and subnormal
+    // results, each one positive and negative
+    {
+        double const e27 = 1. + ldexp(1., -27), tiny = ldexp(1., -1074), dmin = ldexp(1., -1022);
+        std::vector<std::vector<double> > cases = {
+            {e27}, {e27, ldexp(1., -53)}, {e27, ldexp(1., -54)}, {e27, ldexp(1., -54), ldexp(1., -450)},
+            {e27, ldexp(1., -54), -ldexp(1., -450)}, {1., tiny}, {dmin, -tiny}, {1e300, tiny, -1e300}};
+        std::vector<std::vector<double> > factors = {
+            {e27}, {e27, 1.}, {e27, 1.}, {e27, 1., ldexp(1., -450)},
+            {e27, 1., ldexp(1., -450)}, {1., 1.}, {1., 1.}, {1., 1., 1.}};
+        double const exact[] = {
+            1. + ldexp(1., -26), 1. + ldexp(1., -26) + ldexp(1., -52), 1. + ldexp(1., -26), 1. + ldexp(1., -26) + ldexp(1., -52),
+            1. + ldexp(1., -26), 1., dmin - tiny, tiny};
+        for (size_t k = 0; k != cases.size(); ++k) {
+            for (int sign = 1; sign >= -1; sign -= 2) {
+                std::vector<double> c(cases[k]);
+                for (size_t i = 0; i != c.size(); ++i)
+                    c[i] *= sign;
+                double * d = factors[k].data();
+                double results[] = {exdot(c.size(), c.data(), 1, 0, d, 1, 0, 0), exdot(c.size(), c.data(), 1, 0, d, 1, 0, 3),
+                    exdot(c.size(), c.data(), 1, 0, d, 1, 0, 4), exdot(c.size(), c.data(), 1, 0, d, 1, 0, 8, true)};
+                for (int i = 0; i != 4; ++i) {
+                    if (results[i] != sign * exact[k]) {
+                        is_pass = false;
+                        printf("FAILED: exdot rounding of case %d: %a \t %a\n", int(k), results[i], sign * exact[k]);
+                    }
+                }
+            }
+        }
+
+        // The dot product with a negated vector is the negated dot product
+        for (int k = 0; k != 2000; ++k) {
+            double c[16], d[16], e[16];
+            for (int i = 0; i != 16; ++i) {
+                c[i] = randDouble(-30, 30, 2);
+                d[i] = -c[i];
+                e[i] = randDouble(-30, 30, 2);
+            }
+            double dot = exdot(16, c, 1, 0, e, 1, 0, 0), ndot = exdot(16, d, 1, 0, e, 1, 0, 0);
+            if ((ndot != -dot) || (exdot(16, d, 1, 0, e, 1, 0, 4) != ndot) || (exdot(16, d, 1, 0, e, 1, 0, 8, true) != ndot)) {
+                is_pass = false;
+                printf("FAILED: exdot with a negated vector %d: %a \t %a\n", k, ndot, -dot);
+                break;
+            }
+        }
+    }
+
+    // Several asynchronous calls in flight at once
+    std::future<double> exdot_async_acc = exdot_async(N, a, 1, 0, b, 1, 0, 0);
+    std::future<double> exdot_async_fpe4 = exdot_async(N, a, 1, 0, b, 1, 0, 4);
+    std::future<double> exdot_async_fpe8ee = exdot_async(N, a, 1, 0, b, 1, 0, 8, true);
+    double exdot_async_results[] = {exdot_async_acc.get(), exdot_async_fpe4.get(), exdot_async_fpe8ee.get()};
+    for (int i = 0; i != 3; ++i) {
+        if (exdot_async_results[i] != exdot_acc) {
+            is_pass = false;
+            printf("FAILED: exdot_async %.16g\n", exdot_async_results[i]);
+        }
+    }
+
+    // Threads each multiplying their own slices, merged through a loopback transport
+    {
+        int const nparts = 3;
+        exblas::LoopbackTransport loopback(nparts);
+        double parts[nparts][4];
+        std::vector<std::thread> threads;
+        for (int t = 0; t != nparts; ++t) {
+            threads.push_back(std::thread([&, t]() {
+                int64_t l = (int64_t)N * t / nparts, r = (int64_t)N * (t + 1) / nparts;
+                exblas::Context ctx_part(1);
+                ctx_part.set_reduce(exblas::ReduceAll);
+                std::unique_ptr<exblas::LoopbackTransport> member(t ? new exblas::LoopbackTransport(loopback, t) : 0);
+                exblas::LoopbackTransport & group = t ? *member : loopback;
+                double * firsts[] = {a + l, b + l};
+                double * seconds[] = {b + l, a + l};
+                exblas::Request req = exdot_iallreduce(ctx_part, r - l, a + l, b + l, group, 4);
+                parts[t][0] = exdot_dist(ctx_part, r - l, a + l, b + l, group, 8, true);
+                exdot_dist_batch(ctx_part, 2, r - l, firsts, seconds, group, 0, parts[t] + 1);
+                parts[t][3] = req.wait();
+            }));
+        }
+        for (size_t t = 0; t != threads.size(); ++t)
+            threads[t].join();
+        for (int t = 0; t != nparts; ++t) {
+            for (int i = 0; i != 4; ++i) {
+                if (parts[t][i] != exdot_acc) {
+                    is_pass = false;
+                    printf("FAILED: distributed exdot with a loopback transport %.16g \t %.16g\n", parts[t][i], exdot_acc);
+                }
+            }
+        }
+    }
+#else
+    // Vectors already distributed: each process multiplies its own slices, of uneven sizes
+    {
+        double *all = (double*)_mm_malloc(2 * N * sizeof(double), 32);
+        for (int i = 0; (p == 0) && (i != N); ++i) {
+            all[i] = a[i];
+            all[N + i] = b[i];
+        }
+        MPI_Bcast(all, 2 * N, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        int64_t l = (int64_t)N * p / np, r = (int64_t)N * (p + 1) / np;
+        double dist[] = {exdot_dist(r - l, all + l, all + N + l, MPI_COMM_WORLD, 0),
+            exdot_dist(r - l, all + l, all + N + l, MPI_COMM_WORLD, 4), exdot_dist(r - l, all + l, all + N + l, MPI_COMM_WORLD, 8, true)};
+        for (int i = 0; i != 3; ++i) {
+            if ((p == 0) && (dist[i] != exdot_acc)) {
+                is_pass = false;
+                printf("FAILED: exdot_dist %.16g \t %.16g\n", dist[i], exdot_acc);
+            }
+        }
+        // Every rank receives the result rounded on the root
+        exblas::Context ctx_all(2);
+        ctx_all.set_reduce(exblas::ReduceAll);
+        double root = exdot_acc;
+        MPI_Bcast(&root, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        int all_pass = (exdot_dist(ctx_all, r - l, all + l, all + N + l, MPI_COMM_WORLD, 0) == root) && (exdot_dist(ctx_all, r - l, all + l, all + N + l, MPI_COMM_WORLD, 4) == root);
+        MPI_Allreduce(MPI_IN_PLACE, &all_pass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!all_pass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exdot_dist with ReduceAll\n");
+        }
+        // Communicators freed after use, whose handles may be given again to the next ones
+        int dpass = 1;
+        for (int i = 0; i != 3; ++i) {
+            MPI_Comm dup;
+            MPI_Comm_dup(MPI_COMM_WORLD, &dup);
+            dpass &= (exdot_dist(ctx_all, r - l, all + l, all + N + l, dup, 4) == root);
+            MPI_Comm_free(&dup);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &dpass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!dpass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exdot_dist on freed communicators\n");
+        }
+        // Non-blocking reductions in flight while the ranks compute
+        exblas::Request req4 = exdot_iallreduce(ctx_all, r - l, all + l, all + N + l, MPI_COMM_WORLD, 4);
+        exblas::Request req8 = exdot_iallreduce(r - l, all + l, all + N + l, MPI_COMM_WORLD, 8, true);
+        double overlapped = exdot_dist(r - l, all + l, all + N + l, MPI_COMM_WORLD, 0);
+        while (!req8.test())
+            ;
+        int ipass = (req4.wait() == root) && (req8.wait() == root);
+        MPI_Allreduce(MPI_IN_PLACE, &ipass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!ipass || ((p == 0) && (overlapped != root))) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exdot_iallreduce\n");
+        }
+        // Several dot products reduced in a single message, of opposite signs and zero
+        std::vector<double> neg(r - l), zeros(r - l, 0.);
+        for (int64_t i = l; i != r; ++i)
+            neg[i - l] = -all[N + i];
+        double * first[] = {all + l, all + l, all + l};
+        double * second[] = {all + N + l, neg.data(), zeros.data()};
+        double batch[3];
+        exdot_dist_batch(3, r - l, first, second, MPI_COMM_WORLD, 4, batch);
+        int bpass = (batch[0] == root) && (batch[1] == -root) && (batch[2] == 0.);
+        MPI_Allreduce(MPI_IN_PLACE, &bpass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!bpass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exdot_dist_batch\n");
+        }
+        // The same batch twice in a stream, the second one computed while the first one is reduced
+        double * firsts[] = {all + l, all + l, all + l, all + l, all + l, all + l};
+        double * seconds[] = {all + N + l, neg.data(), zeros.data(), all + N + l, neg.data(), zeros.data()};
+        double streamed[6];
+        exdot_dist_pipeline(2, 3, r - l, firsts, seconds, MPI_COMM_WORLD, 4, streamed);
+        int spass = 1;
+        for (int i = 0; i != 6; ++i)
+            spass &= (streamed[i] == batch[i % 3]);
+        MPI_Allreduce(MPI_IN_PLACE, &spass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!spass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exdot_dist_pipeline\n");
+        }
+        _mm_free(all);
+    }
+#endif
+
+#ifdef EXBLAS_MPI
+    if (p == 0) {
+#endif
+    printf("  exdot with superacc = %.16g\n", exdot_acc);
+    printf("  exdot with FPE3 and superacc = %.16g\n", exdot_fpe3);
+    printf("  exdot with FPE4 and superacc = %.16g\n", exdot_fpe4);
+    printf("  exdot with FPE8 and superacc = %.16g\n", exdot_fpe8);
+    printf("  exdot with FPE4 early-exit and superacc = %.16g\n", exdot_fpe4ee);
+    printf("  exdot with FPE6 early-exit and superacc = %.16g\n", exdot_fpe6ee);
+    printf("  exdot with FPE8 early-exit and superacc = %.16g\n", exdot_fpe8ee);
+    printf("  exdotf with superacc = %.8g\n", exdotf_acc);
+    printf("  exdotf with FPE3 and superacc = %.8g\n", exdotf_fpe3);
+    printf("  exdotf with FPE4 early-exit and superacc = %.8g\n", exdotf_fpe4ee);
+    printf("  exdotf with FPE8 early-exit and superacc = %.8g\n", exdotf_fpe8ee);
+    // Single precision results are correctly rounded, hence bitwise identical
+    if (fits_float && ((exdotf_fpe3 != exdotf_acc) || (exdotf_fpe4ee != exdotf_acc) || (exdotf_fpe8ee != exdotf_acc))) {
+        is_pass = false;
+        printf("FAILED: exdotf %.8g \t %.8g \t %.8g \t %.8g\n", exdotf_acc, exdotf_fpe3, exdotf_fpe4ee, exdotf_fpe8ee);
+    }
+
+#ifdef EXBLAS_VS_MPFR
+    double exdotMPFR = ExDOTVsMPFR(N, a, 1, b, 1);
+    printf("  exdot with MPFR = %.16g\n", exdotMPFR);
+    exdot_acc = fabs(exdotMPFR - exdot_acc) / fabs(exdotMPFR);
+    exdot_fpe3 = fabs(exdotMPFR - exdot_fpe3) / fabs(exdotMPFR);
+    exdot_fpe4 = fabs(exdotMPFR - exdot_fpe4) / fabs(exdotMPFR);
+    exdot_fpe8 = fabs(exdotMPFR - exdot_fpe8) / fabs(exdotMPFR);
+    exdot_fpe4ee = fabs(exdotMPFR - exdot_fpe4ee) / fabs(exdotMPFR);
+    exdot_fpe6ee = fabs(exdotMPFR - exdot_fpe6ee) / fabs(exdotMPFR);
+    exdot_fpe8ee = fabs(exdotMPFR - exdot_fpe8ee) / fabs(exdotMPFR);
+    if ((exdot_acc > eps) || (exdot_fpe3 > eps) || (exdot_fpe4 > eps) || (exdot_fpe8 > eps) || (exdot_fpe4ee > eps) || (exdot_fpe6ee > eps) || (exdot_fpe8ee > eps)) {
+        is_pass = false;
+        printf("FAILED: %.16g \t %.16g \t %.16g \t %.16g \t %.16g \t %.16g \t %.16g\n", exdot_acc, exdot_fpe3, exdot_fpe4, exdot_fpe8, exdot_fpe4ee, exdot_fpe6ee, exdot_fpe8ee);
+    }
+#else
+    exdot_fpe3 = fabs(exdot_acc - exdot_fpe3) / fabs(exdot_acc);
+    exdot_fpe4 = fabs(exdot_acc - exdot_fpe4) / fabs(exdot_acc);
+    exdot_fpe8 = fabs(exdot_acc - exdot_fpe8) / fabs(exdot_acc);
+    exdot_fpe4ee = fabs(exdot_acc - exdot_fpe4ee) / fabs(exdot_acc);
+    exdot_fpe6ee = fabs(exdot_acc - exdot_fpe6ee) / fabs(exdot_acc);
+    exdot_fpe8ee = fabs(exdot_acc - exdot_fpe8ee) / fabs(exdot_acc);
+    if ((exdot_fpe3 > eps) || (exdot_fpe4 > eps) || (exdot_fpe8 > eps) || (exdot_fpe4ee > eps) || (exdot_fpe6ee > eps) || (exdot_fpe8ee > eps)) {
+        is_pass = false;
+        printf("FAILED: %.16g \t %.16g \t %.16g \t %.16g \t %.16g \t %.16g\n", exdot_fpe3, exdot_fpe4, exdot_fpe8, exdot_fpe4ee, exdot_fpe6ee, exdot_fpe8ee);
+    }
+#endif
+    fprintf(stderr, "\n");
+
+    if (is_pass)
+        printf("TestPassed; ALL OK!\n");
+    else
+        printf("TestFailed!\n");
+#ifdef EXBLAS_MPI
+    }
+    MPI_Finalize();
+#endif
+
+    return 0;
+}
+
@@ -0,0 +1,298 @@
+/*
+ *  Copyright (c) 2016 Inria and University Pierre and Marie Curie
+ *  All rights reserved.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef EXBLAS_MPI
+    #include <mpi.h>
+#endif
+
+// exblas
+#include "blas2.hpp"
+#include "common.hpp"
+
+
+#ifdef EXBLAS_VS_MPFR
+#include <cstddef>
+#include <mpfr.h>
+
+/*
+ * Returns whether y is A * x + yorig rounded once, with A * x of the column-major matrix A
+ * (or of its transpose, with trans = 'T') computed exactly with MPFR
+ */
+static bool exgemvVsMPFR(char trans, int m, int n, const double *a, int lda, const double *x, const double *yorig, const double *y) {
+    mpfr_t sum, dot;
+    // Products are exact on 106 bits, and their sums on the range of the superaccumulators
+    mpfr_init2(dot, 106);
+    mpfr_init2(sum, 4300);
+
+    int leny = (trans == 'T') ? n : m;
+    int lenx = (trans == 'T') ? m : n;
+    bool same = true;
+    for (int k = 0; k != leny; ++k) {
+        mpfr_set_d(sum, yorig[k], MPFR_RNDN);
+        for (int j = 0; j != lenx; ++j) {
+            mpfr_set_d(dot, (trans == 'T') ? a[j + lda * k] : a[k + lda * j], MPFR_RNDN);
+            mpfr_mul_d(dot, dot, x[j], MPFR_RNDN);
+            mpfr_add(sum, sum, dot, MPFR_RNDN);
+        }
+        double ref = mpfr_get_d(sum, MPFR_RNDN);
+        same &= (y[k] == ref) || (std::isnan(y[k]) && std::isnan(ref));
+    }
+
+    mpfr_clear(dot);
+    mpfr_clear(sum);
+    mpfr_free_cache();
+    return same;
+}
+#endif
+
+#ifndef EXBLAS_MPI
+/*
+ * Runs exgemv_dist among the participants of transport on the submatrix of A made of the given
+ * rows and columns and returns whether y is bitwise identical to ref on the calling participant
+ */
+static bool exgemvPartVsRef(exblas::Context & ctx, exblas::Transport & transport, char trans, int m, int n,
+    const std::vector<int> & rows, const std::vector<int> & cols, double *a, int lda, double *x, double *yorig,
+    const double *ref, int fpe, bool early_exit = false) {
+    int local_m = rows.size(), local_n = cols.size();
+    std::vector<double> local(std::max(local_m * local_n, 1));
+    for (int j = 0; j != local_n; ++j)
+        for (int i = 0; i != local_m; ++i)
+            local[i + local_m * j] = a[rows[i] + lda * cols[j]];
+
+    int leny = (trans == 'T') ? n : m;
+    std::vector<double> y(yorig, yorig + leny);
+    exgemv_dist(ctx, trans, m, n, local_m, local_m ? &rows[0] : 0, local_n, local_n ? &cols[0] : 0,
+        1.0, &local[0], std::max(local_m, 1), x, 1.0, &y[0], transport, fpe, early_exit);
+
+    bool pass = true;
+    for (int k = 0; k != leny; ++k)
+        pass &= (y[k] == ref[k]) || (std::isnan(y[k]) && std::isnan(ref[k]));
+    return pass;
+}
+#else
+/*
+ * Runs exgemv_dist on the submatrix of A made of the given rows and columns and
+ * returns whether y is bitwise identical to ref on all the processes
+ */
+static bool exgemvDistVsRef(char trans, int m, int n, const std::vector<int> & rows, const std::vector<int> & cols,
+    double *a, int lda, double *x, double *yorig, const double *ref, int fpe, bool early_exit = false) {
+    int local_m = rows.size(), local_n = cols.size();
+    std::vector<double> local(std::max(local_m * local_n, 1));
+    for (int j = 0; j != local_n; ++j)
+        for (int i = 0; i != local_m; ++i)
+            local[i + local_m * j] = a[rows[i] + lda * cols[j]];
+
+    int leny = (trans == 'T') ? n : m;
+    std::vector<double> y(yorig, yorig + leny);
+    exgemv_dist(trans, m, n, local_m, local_m ? &rows[0] : 0, local_n, local_n ? &cols[0] : 0,
+        1.0, &local[0], std::max(local_m, 1), x, 1.0, &y[0], MPI_COMM_WORLD, fpe, early_exit);
+
+    int pass = 1;
+    for (int k = 0; k != leny; ++k)
+        pass &= (y[k] == ref[k]) || (std::isnan(y[k]) && std::isnan(ref[k]));
+    MPI_Allreduce(MPI_IN_PLACE, &pass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return pass;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    char trans = 'N';
+    int m = 256, n = 256;
+    bool lognormal = false;
+
+    if(argc > 1)
+        trans = argv[1][0];
+    if(argc > 2)
+        m = atoi(argv[2]);
+    if(argc > 3)
+        n = atoi(argv[3]);
+    if(argc > 6) {
+        if(argv[6][0] == 'n') {
+            lognormal = true;
+        }
+    }
+    int lda = m;
+    int lenx = (trans == 'T') ? m : n;
+    int leny = (trans == 'T') ? n : m;
+
+    int range = 1;
+    int emax = 0;
+    double mean = 1., stddev = 1.;
+    if(lognormal) {
+        stddev = strtod(argv[4], 0);
+        mean = strtod(argv[5], 0);
+    }
+    else {
+        if(argc > 4) {
+            range = atoi(argv[4]);
+        }
+        if(argc > 5) {
+            emax = atoi(argv[5]);
+        }
+    }
+
+    std::vector<double> a(m * n), x(lenx), yorig(leny);
+    int p = 0;
+#ifdef EXBLAS_MPI
+    int np = 1;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &p);
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+    if (p == 0) {
+#endif
+    if(lognormal) {
+        init_lognormal_matrix(true, m, n, &a[0], lda, mean, stddev);
+        init_lognormal(lenx, &x[0], mean, stddev);
+        init_lognormal(leny, &yorig[0], mean, stddev);
+    } else if ((argc > 6) && (argv[6][0] == 'i')) {
+        init_ill_cond(m * n, &a[0], range);
+        init_ill_cond(lenx, &x[0], range);
+        init_ill_cond(leny, &yorig[0], range);
+    } else {
+        init_fpuniform_matrix(true, m, n, &a[0], lda, range, emax);
+        init_fpuniform(lenx, &x[0], range, emax);
+        init_fpuniform(leny, &yorig[0], range, emax);
+    }
+
+    fprintf(stderr, "%d %d ", m, n);
+
+    if(lognormal) {
+        fprintf(stderr, "%f ", stddev);
+    } else {
+        fprintf(stderr, "%d ", range);
+    }
+#ifdef EXBLAS_MPI
+    }
+    // Every process holds the whole problem and cuts its submatrix out of it
+    MPI_Bcast(&a[0], m * n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&x[0], lenx, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&yorig[0], leny, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
+
+    bool is_pass = true;
+    std::vector<double> superacc(yorig), y;
+    exgemv(trans, m, n, 1.0, &a[0], lda, 0, &x[0], 1, 0, 1.0, &superacc[0], 1, 0, 0);
+#ifdef EXBLAS_VS_MPFR
+    // The superaccumulators give the correctly rounded result
+    bool exact = exgemvVsMPFR(trans, m, n, &a[0], lda, &x[0], &yorig[0], &superacc[0]);
+    if (p == 0)
+        printf("Superacc %s MPFR\n", exact ? "matches" : "differs from");
+    is_pass &= exact;
+#endif
+
+    // All the floating-point expansions give the correctly rounded result of the superaccumulators.
+    // The early-exit ones run within a context of their own
+    int fpes[] = {3, 4, 8, 4, 6, 8};
+    exblas::Context ctx_ee(2);
+    for (int f = 0; f != 6; ++f) {
+        y = yorig;
+        if (f >= 3)
+            exgemv(ctx_ee, trans, m, n, 1.0, &a[0], lda, 0, &x[0], 1, 0, 1.0, &y[0], 1, 0, fpes[f], true);
+        else
+            exgemv(trans, m, n, 1.0, &a[0], lda, 0, &x[0], 1, 0, 1.0, &y[0], 1, 0, fpes[f]);
+        bool same = true;
+        for (int k = 0; k != leny; ++k)
+            same &= (y[k] == superacc[k]) || (std::isnan(y[k]) && std::isnan(superacc[k]));
+        if (p == 0)
+            printf("FPE%d%s %s\n", fpes[f], (f >= 3) ? "EE" : "", same ? "matches" : "differs");
+        is_pass &= same;
+    }
+
+#ifdef EXBLAS_MPI
+    {
+        // 1D row-block layout: contiguous rows, all the columns
+        std::vector<int> rows, cols;
+        for (int i = int(int64_t(m) * p / np); i != int(int64_t(m) * (p + 1) / np); ++i)
+            rows.push_back(i);
+        for (int j = 0; j != n; ++j)
+            cols.push_back(j);
+        bool rowblock = exgemvDistVsRef(trans, m, n, rows, cols, &a[0], lda, &x[0], &yorig[0], &superacc[0], 0)
+            && exgemvDistVsRef(trans, m, n, rows, cols, &a[0], lda, &x[0], &yorig[0], &superacc[0], 4);
+        if (p == 0)
+            printf("Row-block on %d processes %s\n", np, rowblock ? "matches" : "differs");
+        is_pass &= rowblock;
+
+        // 2D block-cyclic layout on the most square process grid, with blocks of nb x nb elements
+        int const nb = 16;
+        int pr = 1;
+        for (int d = 1; d * d <= np; ++d)
+            if (np % d == 0)
+                pr = d;
+        int pc = np / pr;
+        rows.clear();
+        cols.clear();
+        for (int i = 0; i != m; ++i)
+            if ((i / nb) % pr == p / pc)
+                rows.push_back(i);
+        for (int j = 0; j != n; ++j)
+            if ((j / nb) % pc == p % pc)
+                cols.push_back(j);
+        bool cyclic = exgemvDistVsRef(trans, m, n, rows, cols, &a[0], lda, &x[0], &yorig[0], &superacc[0], 0)
+            && exgemvDistVsRef(trans, m, n, rows, cols, &a[0], lda, &x[0], &yorig[0], &superacc[0], 8, true);
+        if (p == 0)
+            printf("Block-cyclic on a %d x %d grid %s\n", pr, pc, cyclic ? "matches" : "differs");
+        is_pass &= cyclic;
+    }
+#else
+    // 1D row-block layout on 3 threads, then 2D block-cyclic layout on a 2 x 2 grid of threads,
+    // with blocks of nb x nb elements, merged through a loopback transport
+    for (int layout = 0; layout != 2; ++layout) {
+        int const nb = 16, pr = layout ? 2 : 3, pc = layout ? 2 : 1, nparts = pr * pc;
+        exblas::LoopbackTransport loopback(nparts);
+        int parts[4];
+        std::vector<std::thread> threads;
+        for (int t = 0; t != nparts; ++t) {
+            threads.push_back(std::thread([&, t]() {
+                std::vector<int> rows, cols;
+                int l = int(int64_t(m) * t / pr), r = int(int64_t(m) * (t + 1) / pr);
+                for (int i = 0; i != m; ++i)
+                    if (layout ? ((i / nb) % pr == t / pc) : ((i >= l) && (i < r)))
+                        rows.push_back(i);
+                for (int j = 0; j != n; ++j)
+                    if ((j / nb) % pc == t % pc)
+                        cols.push_back(j);
+                exblas::Context ctx_part(1);
+                std::unique_ptr<exblas::LoopbackTransport> member(t ? new exblas::LoopbackTransport(loopback, t) : 0);
+                exblas::LoopbackTransport & group = t ? *member : loopback;
+                parts[t] = exgemvPartVsRef(ctx_part, group, trans, m, n, rows, cols, &a[0], lda, &x[0], &yorig[0], &superacc[0], 0)
+                    && exgemvPartVsRef(ctx_part, group, trans, m, n, rows, cols, &a[0], lda, &x[0], &yorig[0], &superacc[0], 8, true);
+            }));
+        }
+        bool same = true;
+        for (int t = 0; t != nparts; ++t) {
+            threads[t].join();
+            same &= parts[t];
+        }
+        if (layout)
+            printf("Block-cyclic on a %d x %d grid of threads %s\n", pr, pc, same ? "matches" : "differs");
+        else
+            printf("Row-block on %d threads %s\n", nparts, same ? "matches" : "differs");
+        is_pass &= same;
+    }
+#endif
+    fprintf(stderr, "\n");
+
+#ifdef EXBLAS_MPI
+    if (p == 0) {
+#endif
+    if (is_pass)
+        printf("TestPassed; ALL OK!\n");
+    else
+        printf("TestFailed!\n");
+#ifdef EXBLAS_MPI
+    }
+    MPI_Finalize();
+#endif
+
+    return 0;
+}
@@ -5,8 +5,18 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <mm_malloc.h>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(_OPENMP) && !defined(EXBLAS_MPI)
+    #include <omp.h>
+#endif
 
 #ifdef EXBLAS_MPI
     #include <mpi.h>
@@ -68,16 +78,20 @@ int main(int argc, char * argv[]) {
         }
     }
    
-    double *a; 
+    double *a = NULL;
+    float *af = NULL;
+    bool fits_float = true;
 #ifdef EXBLAS_MPI
-    int np = 1, p;
-    MPI_Init(&argc, &argv);
+    int np = 1, p, provided;
+    // The main thread communicates while the others compute in exsum_dist_pipeline
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &p);
     MPI_Comm_size(MPI_COMM_WORLD, &np);
     if (p == 0) { 
 #endif
     a = (double*)_mm_malloc(N*sizeof(double), 32);
-    if (!a)
+    af = (float*)_mm_malloc(N*sizeof(float), 32);
+    if ((!a) || (!af))
         fprintf(stderr, "Cannot allocate memory for the main array\n");
     if(lognormal) {
         init_lognormal(N, a, mean, stddev);
@@ -90,6 +104,10 @@ int main(int argc, char * argv[]) {
             init_fpuniform(N, a, range, emax);
         }
     }
+    for(int i = 0; i != N; ++i) {
+        af[i] = a[i];
+        fits_float &= std::isfinite(af[i]);
+    }
 
     fprintf(stderr, "%d ", N);
 
@@ -104,12 +122,310 @@ int main(int argc, char * argv[]) {
 
     bool is_pass = true;
     double exsum_acc, exsum_fpe2, exsum_fpe4, exsum_fpe4ee, exsum_fpe6ee, exsum_fpe8ee;
-    exsum_acc = exsum(N, a, 1, 0);
-    exsum_fpe2 = exsum(N, a, 1, 2);
-    exsum_fpe4 = exsum(N, a, 1, 4);
-    exsum_fpe4ee = exsum(N, a, 1, 4, true);
-    exsum_fpe6ee = exsum(N, a, 1, 6, true);
-    exsum_fpe8ee = exsum(N, a, 1, 8, true);
+    exsum_acc = exsum(N, a, 1, 0, 0);
+    exsum_fpe2 = exsum(N, a, 1, 0, 2);
+    exsum_fpe4 = exsum(N, a, 1, 0, 4);
+    exsum_fpe4ee = exsum(N, a, 1, 0, 4, true);
+    exsum_fpe6ee = exsum(N, a, 1, 0, 6, true);
+    exsum_fpe8ee = exsum(N, a, 1, 0, 8, true);
+    // Routines called repeatedly within a user-provided context
+    exblas::Context ctx(2);
+    double exsum_ctx_acc = exsum(ctx, N, a, 1, 0, 0);
+    double exsum_ctx_fpe4 = exsum(ctx, N, a, 1, 0, 4);
+    double exsum_ctx_fpe8ee = exsum(ctx, N, a, 1, 0, 8, true);
+    // Chunks claimed dynamically by the threads
+    ctx.set_schedule(exblas::ScheduleDynamic, 1000);
+    double exsum_dyn_acc = exsum(ctx, N, a, 1, 0, 0);
+    double exsum_dyn_fpe4 = exsum(ctx, N, a, 1, 0, 4);
+    ctx.set_schedule(exblas::ScheduleStatic);
+    // Team sized after the memory bandwidth, with one pinned thread per core
+    exblas::Context ctx_auto(exblas::AutoThreads, exblas::PlacementCores);
+    double exsum_auto_fpe4 = exsum(ctx_auto, N, a, 1, 0, 4);
+    // Sizes of floating-point expansions out of [0, 8] are brought into it
+    double exsum_fpe_low = exsum(N, a, 1, 0, -1), exsum_fpe_high = exsum(N, a, 1, 0, 12, true);
+    // Techniques of floating-point expansions, which fall back to the default ones unless all are built
+    ExFPEOptions opts;
+    opts.sort = opts.victim_cache = true;
+    double exsum_opts = exsum(N, a, 1, 0, 4, opts);
+    // Nested calls from within a parallel region run serially on each thread
+    bool concurrent_pass = true;
+#if defined(_OPENMP) && !defined(EXBLAS_MPI)
+    #pragma omp parallel num_threads(2) reduction(&&:concurrent_pass)
+    {
+        concurrent_pass = (exsum(N, a, 1, 0, 0) == exsum_acc) && (exsum(N, a, 1, 0, 4) == exsum_acc);
+    }
+#endif
+    // Strided, negative-increment, unaligned, and partial vectors, against contiguous copies.
+    // With MPI, the vectors of the root are scattered, and the results compared on the root
+    {
+        bool root = true;
+#ifdef EXBLAS_MPI
+        root = (p == 0);
+#endif
+        int M = (N - 1) / 3;
+        double *c = (double*)_mm_malloc(M * sizeof(double), 32);
+        for (int i = 0; root && (i != M); ++i)
+            c[i] = a[1 + 3 * i];
+        double ref = exsum(M, c, 1, 0, 0);
+        std::vector<double> strided = {exsum(M, a, 3, 1, 0), exsum(M, a, 3, 1, 4), exsum(M, a, -3, 1, 8, true)};
+#ifndef EXBLAS_MPI
+        // With MPI, each process passes its own part of the vector to the 64-bit routines
+        strided.push_back(exsum_64(M, a, 3, 1, 0));
+        strided.push_back(exsum_64(M, a, -3, 1, 4));
+#endif
+        for (size_t i = 0; root && (i != strided.size()); ++i) {
+            if (strided[i] != ref) {
+                is_pass = false;
+                printf("FAILED: exsum with increments %.16g \t %.16g\n", strided[i], ref);
+            }
+        }
+        double unaligned = exsum(M - 1, c, 1, 1, 4);
+        double shifted = exsum(M - 1, c + 1, 1, 0, 0);
+        if (root && (unaligned != shifted)) {
+            is_pass = false;
+            printf("FAILED: exsum of an unaligned vector\n");
+        }
+#ifndef EXBLAS_MPI
+        if (fits_float && (exsumf_64(N, af, 1, 0, 8, true) != exsumf(N, af, 1, 0, 0))) {
+            is_pass = false;
+            printf("FAILED: exsumf_64\n");
+        }
+#endif
+        _mm_free(c);
+    }
+#ifndef EXBLAS_MPI
+    // Sums of known rounding: ties and sticky bits right below the last bit of results in [2^52, 2^53),
+    // cancellations, and subnormal inputs and results, each one positive and negative
+    {
+        double const two52 = ldexp(1., 52), tiny = ldexp(1., -1074), dmin = ldexp(1., -1022);
+        std::vector<std::vector<double> > cases = {
+            {two52, 0.5}, {two52 + 1, 0.5}, {two52, 0.5, ldexp(1., -100)}, {two52, 0.5, -ldexp(1., -100)},
+            {2 * two52 - 1, 0.5}, {1., ldexp(1., -53), tiny}, {1., tiny},
+            {tiny}, {tiny, tiny, tiny}, {dmin, -tiny}, {1e300, tiny, -1e300}, {dmin, dmin / 2, -dmin}};
+        double const exact[] = {
+            two52, two52 + 2, two52 + 1, two52,
+            2 * two52, 1. + ldexp(1., -52), 1.,
+            tiny, 3 * tiny, dmin - tiny, tiny, dmin / 2};
+        for (size_t k = 0; k != cases.size(); ++k) {
+            for (int sign = 1; sign >= -1; sign -= 2) {
+                std::vector<double> c(cases[k]);
+                for (size_t i = 0; i != c.size(); ++i)
+                    c[i] *= sign;
+                double results[] = {exsum(c.size(), c.data(), 1, 0, 0), exsum(c.size(), c.data(), 1, 0, 2),
+                    exsum(c.size(), c.data(), 1, 0, 4), exsum(c.size(), c.data(), 1, 0, 8, true)};
+                for (int i = 0; i != 4; ++i) {
+                    if (results[i] != sign * exact[k]) {
+                        is_pass = false;
+                        printf("FAILED: exsum rounding of case %d: %a \t %a\n", int(k), results[i], sign * exact[k]);
+                    }
+                }
+            }
+        }
+
+        float const two23 = ldexpf(1.f, 23), ftiny = ldexpf(1.f, -149), fmin = ldexpf(1.f, -126);
+        std::vector<std::vector<float> > fcases = {
+            {two23, 0.5f}, {two23 + 1, 0.5f}, {1.f, ldexpf(1.f, -24), ftiny},
+            {ftiny, ftiny, ftiny}, {fmin, -ftiny}, {1.f, ftiny, -1.f}, {fmin, fmin / 2, -fmin}};
+        float const fexact[] = {two23, two23 + 2, 1.f + ldexpf(1.f, -23), 3 * ftiny, fmin - ftiny, ftiny, fmin / 2};
+        for (size_t k = 0; k != fcases.size(); ++k) {
+            for (int sign = 1; sign >= -1; sign -= 2) {
+                std::vector<float> c(fcases[k]);
+                for (size_t i = 0; i != c.size(); ++i)
+                    c[i] *= sign;
+                float results[] = {exsumf(c.size(), c.data(), 1, 0, 0), exsumf(c.size(), c.data(), 1, 0, 4),
+                    exsumf(c.size(), c.data(), 1, 0, 8, true)};
+                for (int i = 0; i != 3; ++i) {
+                    if (results[i] != sign * fexact[k]) {
+                        is_pass = false;
+                        printf("FAILED: exsumf rounding of case %d: %a \t %a\n", int(k), results[i], sign * fexact[k]);
+                    }
+                }
+            }
+        }
+
+        // The sum of a negated vector is the negated sum, including when rounding a negative
+        // superaccumulator crosses a carry between digits
+        for (int k = 0; k != 2000; ++k) {
+            double c[16], d[16];
+            for (int i = 0; i != 16; ++i) {
+                c[i] = randDouble(-60, 60, 2);
+                d[i] = -c[i];
+            }
+            double sum = exsum(16, c, 1, 0, 0), nsum = exsum(16, d, 1, 0, 0);
+            if ((nsum != -sum) || (exsum(16, d, 1, 0, 4) != nsum) || (exsum(16, d, 1, 0, 8, true) != nsum)) {
+                is_pass = false;
+                printf("FAILED: exsum of negated vector %d: %a \t %a\n", k, nsum, -sum);
+                break;
+            }
+        }
+    }
+    // Several asynchronous calls in flight at once
+    std::future<double> exsum_async_acc = exsum_async(N, a, 1, 0, 0);
+    std::future<double> exsum_async_fpe4 = exsum_async(N, a, 1, 0, 4);
+    std::future<double> exsum_async_fpe8ee = exsum_async(N, a, 1, 0, 8, true);
+    double exsum_async_results[] = {exsum_async_acc.get(), exsum_async_fpe4.get(), exsum_async_fpe8ee.get()};
+    for (int i = 0; i != 3; ++i)
+        concurrent_pass &= (exsum_async_results[i] == exsum_acc);
+    // Threads each summing their own slice, merged within the process and through shared memory
+    {
+        int const nparts = 3;
+        exblas::LoopbackTransport loopback(nparts);
+        char name[64];
+        snprintf(name, sizeof(name), "/exblas-test-%d", int(getpid()));
+        // A segment of the same name left over by an earlier group is replaced
+        int stale = shm_open(name, O_CREAT | O_RDWR, 0600);
+        if ((stale < 0) || (ftruncate(stale, 1 << 20) != 0))
+            printf("Cannot leave a segment over\n");
+        if (stale >= 0)
+            close(stale);
+        double parts[nparts][4];
+        int dist_pass[nparts];
+        std::vector<std::thread> threads;
+        for (int t = 0; t != nparts; ++t) {
+            threads.push_back(std::thread([&, t]() {
+                int64_t l = (int64_t)N * t / nparts, r = (int64_t)N * (t + 1) / nparts;
+                exblas::Context ctx_part(1);
+                std::unique_ptr<exblas::LoopbackTransport> member(t ? new exblas::LoopbackTransport(loopback, t) : 0);
+                exblas::LoopbackTransport & group = t ? *member : loopback;
+                ctx_part.set_transport(&group);
+                parts[t][0] = exsum(ctx_part, r - l, a + l, 1, 0, 0);
+                parts[t][1] = exsum(ctx_part, r - l, a + l, 1, 0, 8, true);
+                // The distributed routines, on slices of opposite signs
+                std::vector<double> neg(r - l);
+                for (int64_t i = l; i != r; ++i)
+                    neg[i - l] = -a[i];
+                double * vectors[] = {a + l, neg.data(), neg.data(), a + l};
+                double batch[2], streamed[4];
+                ctx_part.set_reduce(exblas::ReduceAll);
+                exblas::Request req = exsum_iallreduce(ctx_part, r - l, a + l, group, 4);
+                double dist = exsum_dist(ctx_part, r - l, a + l, group, 8, true);
+                exsum_dist_batch(ctx_part, 2, r - l, vectors, group, 4, batch);
+                exsum_dist_pipeline(ctx_part, 2, 2, r - l, vectors, group, 0, streamed);
+                dist_pass[t] = (req.wait() == exsum_acc) && (dist == exsum_acc) && (batch[0] == exsum_acc) && (batch[1] == -exsum_acc)
+                    && (streamed[0] == exsum_acc) && (streamed[1] == -exsum_acc) && (streamed[2] == -exsum_acc) && (streamed[3] == exsum_acc);
+                exblas::SharedTransport shared(name, t, nparts);
+                if (!shared.is_open()) {
+                    parts[t][2] = parts[t][3] = 0.;
+                    return;
+                }
+                ctx_part.set_transport(&shared);
+                parts[t][2] = exsum(ctx_part, r - l, a + l, 1, 0, 4);
+                parts[t][3] = exsum(ctx_part, r - l, a + l, 1, 0, 0);
+            }));
+        }
+        for (int t = 0; t != nparts; ++t)
+            threads[t].join();
+        for (int t = 0; t != nparts; ++t) {
+            for (int i = 0; i != 4; ++i) {
+                if (parts[t][i] != exsum_acc) {
+                    is_pass = false;
+                    printf("FAILED: exsum with a %s transport %.16g \t %.16g\n", (i < 2) ? "loopback" : "shared", parts[t][i], exsum_acc);
+                }
+            }
+            if (!dist_pass[t]) {
+                is_pass = false;
+                printf("FAILED: distributed exsum with a loopback transport on participant %d\n", t);
+            }
+        }
+    }
+#else
+    // Vector already distributed: each process sums its own slice, of uneven sizes
+    {
+        double *all = (double*)_mm_malloc(N * sizeof(double), 32);
+        for (int i = 0; (p == 0) && (i != N); ++i)
+            all[i] = a[i];
+        MPI_Bcast(all, N, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        int64_t l = (int64_t)N * p / np, r = (int64_t)N * (p + 1) / np;
+        double dist[] = {exsum_dist(r - l, all + l, MPI_COMM_WORLD, 0),
+            exsum_dist(r - l, all + l, MPI_COMM_WORLD, 4), exsum_dist(r - l, all + l, MPI_COMM_WORLD, 8, true)};
+        for (int i = 0; i != 3; ++i) {
+            if ((p == 0) && (dist[i] != exsum_acc)) {
+                is_pass = false;
+                printf("FAILED: exsum_dist %.16g \t %.16g\n", dist[i], exsum_acc);
+            }
+        }
+        // Every rank receives the result rounded on the root
+        exblas::Context ctx_all(2);
+        ctx_all.set_reduce(exblas::ReduceAll);
+        double root = exsum_acc;
+        MPI_Bcast(&root, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        int all_pass = (exsum_dist(ctx_all, r - l, all + l, MPI_COMM_WORLD, 0) == root) && (exsum_dist(ctx_all, r - l, all + l, MPI_COMM_WORLD, 4) == root);
+        MPI_Allreduce(MPI_IN_PLACE, &all_pass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!all_pass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exsum_dist with ReduceAll\n");
+        }
+        // Non-blocking reductions in flight while the ranks compute
+        exblas::Request req4 = exsum_iallreduce(ctx_all, r - l, all + l, MPI_COMM_WORLD, 4);
+        exblas::Request req8 = exsum_iallreduce(r - l, all + l, MPI_COMM_WORLD, 8, true);
+        double overlapped = exsum_dist(r - l, all + l, MPI_COMM_WORLD, 0);
+        while (!req8.test())
+            ;
+        int ipass = (req4.wait() == root) && (req8.wait() == root);
+        MPI_Allreduce(MPI_IN_PLACE, &ipass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!ipass || ((p == 0) && (overlapped != root))) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exsum_iallreduce\n");
+        }
+        // Several sums reduced in a single message, of opposite signs and zero
+        std::vector<double> neg(r - l), zeros(r - l, 0.);
+        for (int64_t i = l; i != r; ++i)
+            neg[i - l] = -all[i];
+        double * vectors[] = {all + l, neg.data(), zeros.data()};
+        double batch[3];
+        exsum_dist_batch(3, r - l, vectors, MPI_COMM_WORLD, 4, batch);
+        int bpass = (batch[0] == root) && (batch[1] == -root) && (batch[2] == 0.);
+        MPI_Allreduce(MPI_IN_PLACE, &bpass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!bpass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exsum_dist_batch\n");
+        }
+        // A stream of batches, each one summed while the previous one is reduced
+        int const steps = 5;
+        double * stream[steps * 3];
+        double expected[steps * 3], streamed[steps * 3];
+        for (int i = 0; i != steps * 3; ++i) {
+            stream[i] = vectors[(i + i / 3) % 3];
+            expected[i] = batch[(i + i / 3) % 3];
+        }
+        exsum_dist_pipeline(steps, 3, r - l, stream, MPI_COMM_WORLD, 4, streamed);
+        int spass = 1;
+        for (int i = 0; i != steps * 3; ++i)
+            spass &= (streamed[i] == expected[i]);
+        MPI_Allreduce(MPI_IN_PLACE, &spass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!spass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exsum_dist_pipeline\n");
+        }
+        // The same slices merged by a transport instead of the distributed routines
+        exblas::MpiTransport mpi(MPI_COMM_WORLD);
+        exblas::Context ctx_mpi(2);
+        ctx_mpi.set_transport(&mpi);
+        int tpass = (exsum(ctx_mpi, r - l, all + l, 1, 0, 0) == root) && (exsum(ctx_mpi, r - l, all + l, 1, 0, 4) == root);
+        MPI_Allreduce(MPI_IN_PLACE, &tpass, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!tpass) {
+            is_pass = false;
+            if (p == 0)
+                printf("FAILED: exsum with an MPI transport\n");
+        }
+        _mm_free(all);
+    }
+#endif
+
+    double exsum_facc, exsum_ffpe4, exsum_ffpe8ee;
+    exsum_facc = exsum(N, af, 1, 0, 0);
+    exsum_ffpe4 = exsum(N, af, 1, 0, 4);
+    exsum_ffpe8ee = exsum(N, af, 1, 0, 8, true);
+    float exsumf_acc, exsumf_fpe2, exsumf_fpe4, exsumf_fpe4ee, exsumf_fpe8ee;
+    exsumf_acc = exsumf(N, af, 1, 0, 0);
+    exsumf_fpe2 = exsumf(N, af, 1, 0, 2);
+    exsumf_fpe4 = exsumf(N, af, 1, 0, 4);
+    exsumf_fpe4ee = exsumf(N, af, 1, 0, 4, true);
+    exsumf_fpe8ee = exsumf(N, af, 1, 0, 8, true);
 
 #ifdef EXBLAS_MPI
     if (p == 0) {
@@ -120,6 +436,53 @@ int main(int argc, char * argv[]) {
     printf("  exsum with FPE4 early-exit and superacc = %.16g\n", exsum_fpe4ee);
     printf("  exsum with FPE6 early-exit and superacc = %.16g\n", exsum_fpe6ee);
     printf("  exsum with FPE8 early-exit and superacc = %.16g\n", exsum_fpe8ee);
+    printf("  exsum with superacc within a context = %.16g\n", exsum_ctx_acc);
+    printf("  exsum with FPE4 and superacc within a context = %.16g\n", exsum_ctx_fpe4);
+    printf("  exsum with FPE8 early-exit and superacc within a context = %.16g\n", exsum_ctx_fpe8ee);
+    if ((exsum_ctx_acc != exsum_acc) || (exsum_ctx_fpe4 != exsum_acc) || (exsum_ctx_fpe8ee != exsum_acc)) {
+        is_pass = false;
+        printf("FAILED: exsum within a context %.16g \t %.16g \t %.16g\n", exsum_ctx_acc, exsum_ctx_fpe4, exsum_ctx_fpe8ee);
+    }
+    printf("  exsum with superacc and dynamic scheduling = %.16g\n", exsum_dyn_acc);
+    printf("  exsum with FPE4 and superacc and dynamic scheduling = %.16g\n", exsum_dyn_fpe4);
+    if ((exsum_dyn_acc != exsum_acc) || (exsum_dyn_fpe4 != exsum_acc)) {
+        is_pass = false;
+        printf("FAILED: exsum with dynamic scheduling %.16g \t %.16g\n", exsum_dyn_acc, exsum_dyn_fpe4);
+    }
+    printf("  exsum with FPE4 and superacc with %d pinned threads = %.16g\n", ctx_auto.get_num_threads(), exsum_auto_fpe4);
+    if (exsum_auto_fpe4 != exsum_acc) {
+        is_pass = false;
+        printf("FAILED: exsum with pinned threads %.16g\n", exsum_auto_fpe4);
+    }
+    if ((exsum_fpe_low != exsum_acc) || (exsum_fpe_high != exsum_acc)) {
+        is_pass = false;
+        printf("FAILED: exsum with fpe out of [0, 8] %.16g \t %.16g\n", exsum_fpe_low, exsum_fpe_high);
+    }
+    if (exsum_opts != exsum_acc) {
+        is_pass = false;
+        printf("FAILED: exsum with ExFPEOptions %.16g\n", exsum_opts);
+    }
+    if (!concurrent_pass) {
+        is_pass = false;
+        printf("FAILED: exsum called from within a parallel region or asynchronously\n");
+    }
+    printf("  exsum of floats with superacc = %.16g\n", exsum_facc);
+    printf("  exsum of floats with FPE4 and superacc = %.16g\n", exsum_ffpe4);
+    printf("  exsum of floats with FPE8 early-exit and superacc = %.16g\n", exsum_ffpe8ee);
+    if (fits_float && ((exsum_ffpe4 != exsum_facc) || (exsum_ffpe8ee != exsum_facc))) {
+        is_pass = false;
+        printf("FAILED: exsum of floats %.16g \t %.16g \t %.16g\n", exsum_facc, exsum_ffpe4, exsum_ffpe8ee);
+    }
+    printf("  exsumf with superacc = %.8g\n", exsumf_acc);
+    printf("  exsumf with FPE2 and superacc = %.8g\n", exsumf_fpe2);
+    printf("  exsumf with FPE4 and superacc = %.8g\n", exsumf_fpe4);
+    printf("  exsumf with FPE4 early-exit and superacc = %.8g\n", exsumf_fpe4ee);
+    printf("  exsumf with FPE8 early-exit and superacc = %.8g\n", exsumf_fpe8ee);
+    // Single precision results are correctly rounded, hence bitwise identical
+    if (fits_float && ((exsumf_fpe2 != exsumf_acc) || (exsumf_fpe4 != exsumf_acc) || (exsumf_fpe4ee != exsumf_acc) || (exsumf_fpe8ee != exsumf_acc))) {
+        is_pass = false;
+        printf("FAILED: exsumf %.8g \t %.8g \t %.8g \t %.8g \t %.8g\n", exsumf_acc, exsumf_fpe2, exsumf_fpe4, exsumf_fpe4ee, exsumf_fpe8ee);
+    }
 
 #ifdef EXBLAS_VS_MPFR
     double exsumMPFR = ExSUMVsMPFR(N, a);
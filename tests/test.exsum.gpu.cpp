@@ -5,10 +5,16 @@
 
 #include "blas1.hpp"
 #include "common.hpp"
+#include "common.gpu.hpp"
 
+#include <dirent.h>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <string>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // All OpenCL headers
 #if defined (__APPLE__) || defined(MACOSX)
@@ -38,6 +44,49 @@ double ExSUMVsMPFR(int N, double *a) {
 }
 #endif
 
+/*
+ * Returns the files of dir with their inode numbers, which change when a file is written anew
+ */
+static std::map<std::string, ino_t> ExCacheFiles(const std::string &dir) {
+    std::map<std::string, ino_t> files;
+    DIR *handle = opendir(dir.c_str());
+    for (struct dirent *entry = handle ? readdir(handle) : NULL; entry; entry = readdir(handle)) {
+        std::string path = dir + '/' + entry->d_name;
+        struct stat info;
+        if ((entry->d_name[0] != '.') && (stat(path.c_str(), &info) == 0))
+            files[path] = info.st_ino;
+    }
+    if (handle)
+        closedir(handle);
+    return files;
+}
+
+/*
+ * Rewrites the given binaries in place: with the identity of another device (spoil = 1),
+ * with a corrupt binary after their identity (spoil = 2), or as foreign files (spoil = 3)
+ */
+static void ExCacheSpoil(const std::map<std::string, ino_t> &files, int spoil) {
+    for (std::map<std::string, ino_t>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        std::string content;
+        FILE *handle = fopen(it->first.c_str(), "rb");
+        for (int c = handle ? fgetc(handle) : EOF; c != EOF; c = fgetc(handle))
+            content += (char) c;
+        if (handle)
+            fclose(handle);
+
+        if (spoil == 1)
+            content.insert(content.find('\n') + 1, "Another ");
+        else if (spoil == 2)
+            content = content.substr(0, content.find('\0') + 1) + std::string(64, '?');
+        else
+            content = "Not an ExBLAS binary\n";
+        handle = fopen(it->first.c_str(), "wb");
+        if (handle) {
+            fwrite(content.data(), sizeof(char), content.size(), handle);
+            fclose(handle);
+        }
+    }
+}
 
 int main(int argc, char *argv[]) {
     double eps = 1e-16;
@@ -112,6 +161,12 @@ int main(int argc, char *argv[]) {
     printf("  exsum with FPE6 early-exit and superacc = %.16g\n", exsum_fpe6ee);
     printf("  exsum with FPE8 early-exit and superacc = %.16g\n", exsum_fpe8ee);
 
+    // Calls reusing the OpenCL context, programs and buffers of the first ones give the same results
+    if ((exsum(N, a, 1, 0, 4) != exsum_fpe4) || (exsum(N, a, 1, 0, 0) != exsum_acc) || (exsum(N, a, 1, 0, 8, true) != exsum_fpe8ee)) {
+        is_pass = false;
+        printf("FAILED: repeated calls differ\n");
+    }
+
 #ifdef EXBLAS_VS_MPFR
     double exsumMPFR = ExSUMVsMPFR(N, a);
     printf("  exsum with MPFR = %.16g\n", exsumMPFR);
@@ -140,6 +195,48 @@ int main(int argc, char *argv[]) {
         printf("FAILED: %.16g \t %.16g \t %.16g \t %.16g \t %.16g \t %.16g \t %.16g\n", exsum_fpe2, exsum_fpe3, exsum_fpe4, exsum_fpe8, exsum_fpe4ee, exsum_fpe6ee, exsum_fpe8ee);
     }
 #endif
+
+    // Binaries kept on disk by one run are loaded by the next ones, and rebuilt when they come from another
+    // device, are corrupt, or are not ExBLAS binaries. Each run starts by releasing the OpenCL objects
+    {
+        char dir[] = "/tmp/exblas.cache.XXXXXX";
+        const char *previous = getenv("EXBLAS_OPENCL_CACHE");
+        std::string saved = previous ? previous : "";
+        if (!mkdtemp(dir)) {
+            is_pass = false;
+            printf("FAILED: cannot create a cache directory\n");
+        } else {
+            setenv("EXBLAS_OPENCL_CACHE", dir, 1);
+            ExOCLRelease();
+            double stored = exsum(N, a, 1, 0, 4);
+            std::map<std::string, ino_t> files = ExCacheFiles(dir);
+            const char *binaries[] = {"cached", "another device's", "corrupt", "foreign"};
+            for (int spoil = 0; spoil != 4; ++spoil) {
+                if (spoil)
+                    ExCacheSpoil(files, spoil);
+                ExOCLRelease();
+                double loaded = exsum(N, a, 1, 0, 4);
+
+                // Loaded binaries are left as they are, the others are stored anew, without temporary files left
+                std::map<std::string, ino_t> now = ExCacheFiles(dir);
+                bool kept = !files.empty() && (now.size() == files.size());
+                for (std::map<std::string, ino_t>::iterator it = files.begin(); kept && (it != files.end()); ++it)
+                    kept = now.count(it->first) && ((now[it->first] == it->second) == (spoil == 0));
+                if (!kept || (loaded != stored)) {
+                    is_pass = false;
+                    printf("FAILED: exsum with %s binaries %.16g \t %.16g\n", binaries[spoil], loaded, stored);
+                }
+                files = now;
+            }
+            for (std::map<std::string, ino_t>::iterator it = files.begin(); it != files.end(); ++it)
+                remove(it->first.c_str());
+            rmdir(dir);
+            if (previous)
+                setenv("EXBLAS_OPENCL_CACHE", saved.c_str(), 1);
+            else
+                unsetenv("EXBLAS_OPENCL_CACHE");
+        }
+    }
     fprintf(stderr, "\n");
 
     if (is_pass)